@@ -11,8 +11,8 @@
  *   D8:  (O) LED red (cathode)
  *   D9:  (O) LED green (cathode)
  *   D10: (O) LED blue (cathode)
- *   D11: unused (routed to external I/O header)
- *   D12: unused (routed to external I/O header)
+ *   D11: (O) ISR timing trace if PIN_TRACE, else unused (external I/O header)
+ *   D12: (O) step timing trace if PIN_TRACE, else unused (external I/O header)
  *   D13: (O) magnetic coil (and UNO on-board LED)
  *   GND: neopixel, vibration, quadrature common
  *   5v:  neopixel, LED common (anode)
@@ -50,3 +50,136 @@
 /* Length of match runtime 4 minutes, plus allow the countdown time */
 #define MATCH_RUNTIME    ((4L*60L+COUNTDOWN_TIME)*MSECS)
 
+/* Where the match clock gets its time from, in ms (see MatchClock.h).
+ *    A build can run the match faster or slower than real time, or
+ *    from some other clock, by defining this.
+ */
+#ifndef MATCH_CLOCK_SOURCE
+#define MATCH_CLOCK_SOURCE()  millis()
+#endif
+
+
+/* Set to 1 to measure input-to-output latency (vibration hit to saber
+ *    flash, encoder edge to quadrature LED update) and include it in
+ *    the stage reports. Off by default, as it puts a micros() call in
+ *    the encoder and vibration interrupts.
+ */
+#ifndef LATENCY_STATS
+#define LATENCY_STATS    0
+#endif
+
+/* Quadrature decoding mode. QUADRATURE_EDGE takes a pin change interrupt
+ *    on every edge of both encoder channels. QUADRATURE_SAMPLED samples 
+ *    both channels from a fixed rate Timer2 interrupt instead - the ISR
+ *    load is constant however fast the edges come, and contact bounce
+ *    shorter than a sample period is filtered out.
+ */
+#define QUADRATURE_EDGE       0
+#define QUADRATURE_SAMPLED    1
+#ifndef QUADRATURE_MODE
+#define QUADRATURE_MODE       QUADRATURE_EDGE
+#endif
+#define QUADRATURE_SAMPLE_HZ  16000
+
+/* Quadrature decoding resolution - 4 (every edge of both channels, 96
+ *    counts per revolution), 2 or 1. Lower resolutions only interrupt on
+ *    channel A, and the stage 3 revolution and center window constants
+ *    follow the resolution automatically.
+ */
+#ifndef QUADRATURE_RESOLUTION
+#define QUADRATURE_RESOLUTION 4
+#endif
+
+/* Pin change ports whose interrupt vector is not SimplePinChange's (bit
+ *    n for PCINTn). The encoder interrupt in Quadrature.cpp owns PCINT2
+ *    (pins 0-7) in both decoding modes - the sampled mode leaves it
+ *    masked, but the vector is still defined - so no pin of that port
+ *    can be attached with SimplePinChange.
+ */
+#ifndef SIMPLEPINCHANGE_EXTERNAL_PORTS
+#define SIMPLEPINCHANGE_EXTERNAL_PORTS (1 << 2)
+#endif
+
+/* One pass of the wait forever once the match is over - nothing to do
+ *    on the arena. The host simulator defines this to hand control back
+ *    once it has no more input for the sketch (see HostTools/HostCore).
+ */
+#ifndef ARENA_HALT
+#define ARENA_HALT()
+#endif
+
+/* Set to 1 to stream a binary trace of every match input (encoder and
+ *    vibration edges, buttons, pattern choices) out of the serial port
+ *    along with the text log, at TRACE_BAUD, which keeps up with the
+ *    knob to about 15 revolutions/sec (see Trace.h). Capture the port
+ *    raw (not with the Arduino serial monitor) and replay it with
+ *    HostTools/arenareplay.
+ */
+#ifndef TRACE_RECORD
+#define TRACE_RECORD          0
+#endif
+#define TRACE_BAUD            115200
+
+/* Set to a frame rate (20, say) to stream a binary frame of the match
+ *    state that many times a second out of the serial port, along with
+ *    the text log, for HostTools/arenatelemetry to turn into a time
+ *    series (see Telemetry.h). 0 is off.
+ */
+#ifndef TELEMETRY_HZ
+#define TELEMETRY_HZ          0
+#endif
+
+/* Checkpoint the match every CHECKPOINT_PERIOD ms of match time, and
+ *    keep the watchdog on while it runs, so a hang costs a few hundred
+ *    ms of the match rather than the match (see Checkpoint.h). Set to 0
+ *    to leave the watchdog off.
+ */
+#ifndef CHECKPOINT
+#define CHECKPOINT            1
+#endif
+#define CHECKPOINT_PERIOD     100
+
+/* Set to 1 on boards whose bootloader passes the reset cause in r2
+ *    (optiboot 6 and later), so a brownout reset resumes the match as
+ *    well. The optiboot the UNO ships with clears MCUSR and does not
+ *    pass it on, so there a brownout starts the match over.
+ */
+#ifndef CHECKPOINT_BOOT_CAUSE
+#define CHECKPOINT_BOOT_CAUSE 0
+#endif
+
+/* Set to 1 to put the CPU to sleep (idle mode) between loop() passes
+ *    of the match when no stage has anything to do until the next
+ *    interrupt (see Idle.h)
+ */
+#ifndef IDLE_SLEEP
+#define IDLE_SLEEP            1
+#endif
+
+/* Set to 1 to show the interrupt routines on D11 and the loop() steps
+ *    on D12 for a logic analyzer, each window tagged with a pulse code
+ *    of its source (see PinTrace.h)
+ */
+#ifndef PIN_TRACE
+#define PIN_TRACE             0
+#endif
+
+/* RAM the C runtime leaves alone at reset. The host build puts it in a
+ *    section of its own, which the simulator carries across a reset.
+ */
+#ifndef ARENA_NOINIT
+#define ARENA_NOINIT          __attribute__((section(".noinit")))
+#endif
+
+/* Set to 1 ('make profile' in HostTools does) to keep the functions
+ *    HostTools/avrprof times out of line. Each is called from one place,
+ *    and with LTO it is inlined there and its symbol is gone.
+ */
+#ifndef PROFILE_CALLS
+#define PROFILE_CALLS         0
+#endif
+#if PROFILE_CALLS
+#define ARENA_PROFILED        __attribute__((noinline))
+#else
+#define ARENA_PROFILED
+#endif
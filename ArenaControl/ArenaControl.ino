@@ -6,7 +6,9 @@
  *
  * Each stage is confined within it's own class, with a start,
  *    step, and stop method. Each of the stages is declared 
- *    withi this file. In the Arduino setup() phase, the match
+ *    withi this file, and handed references to what it needs
+ *    of the others, and the stages are run as one StageList
+ *    (see StageList.h). In the Arduino setup() phase, the match
  *    start and end time is calculated, and the start() method
  *    for each stage class is invoked. Each stage is responsible
  *    for initializing the I/O pins, interrupts, initial state,
@@ -17,6 +19,8 @@
  *    to determine what action should be taken at that time. 
  *    Most of the stages use a finite state machine (FSM) to
  *    control the sequence of events within the stage.
+ *    Every stage gets the same match time, sampled once at
+ *    the top of each pass (see MatchClock.h).
  * Once the competition match time has expired, the stop()
  *    method for each stage is invoked, ending the competition
  *    and updating the score for that stage.
@@ -29,6 +33,21 @@
  *    competition easier by the judges. It is an optional item
  *    that is not needed for the student practice arenas, and
  *    the rest of the code will function fine without it.
+ *    The results of the last few matches are also kept in the
+ *    EEPROM (see ResultLog.h), and sending 'D' to the serial
+ *    port dumps them. During the match, the serial port takes
+ *    one letter queries of the match state (see Console.h).
+ *
+ * Between passes of the match, the CPU sleeps until the next
+ *    interrupt whenever none of the stages has anything to do
+ *    (see Idle.h). A build with PIN_TRACE set shows the interrupt
+ *    routines and the steps of each pass on D11/D12 for a logic
+ *    analyzer (see PinTrace.h).
+ *
+ * The watchdog is on while a match runs, and the stages are
+ *    checkpointed every 100ms (see Checkpoint.h). If the sketch
+ *    hangs, the watchdog resets the arena and setup() carries
+ *    on with the match from its last checkpoint.
  *
  * In the advent of no serial LCD, the competition countdown
  *    will start as soon as the Arduino is powered on (or reset)
@@ -49,7 +68,6 @@
  
 #include <Adafruit_NeoPixel.h>
 #include <LiquidCrystal_I2C.h>
-#include <MsTimer2.h>
 #include <Wire.h>
 
 #include "Arduino.h"
@@ -58,12 +76,29 @@
 #include "Stage2.h"
 #include "Stage3.h"
 #include "Controller.h"
+#include "StageList.h"
+#include "ResultLog.h"
+#include "Checkpoint.h"
+#include "Trace.h"
+#include "Timebase.h"
+#include "MatchClock.h"
+#include "Idle.h"
+#include "Console.h"
+#include "Telemetry.h"
+#include "PinTrace.h"
 
-Stage1 stage1;
-Stage2 stage2;
-Stage3 stage3;
 Controller controller;
-uint32_t startTimestamp = 0;
+Stage1 stage1(controller);
+Stage2 stage2(controller);
+Stage3 stage3(stage1.turnPattern, controller);
+
+// Stage 3 starts with the turn pattern stage 1 chose, so comes after it
+static constexpr StageList<Stage1, Stage2, Stage3> stages(stage1, stage2, stage3);
+
+MatchCheckpoint Checkpoint(stage1, stage2, stage3);
+ResultLog Results(stage1, stage2, stage3);
+QueryConsole Console(stage2, stage3);
+TelemetryStream Telemetry(stage2, stage3);
 
 extern unsigned int __bss_end;
 extern unsigned int __heap_start;
@@ -72,22 +107,35 @@ extern void *__brkval;
 uint16_t getFreeSram() {
   uint8_t newVariable;
   // heap is empty, use bss as start memory address
-  if ((uint16_t)__brkval == 0)
-    return (((uint16_t)&newVariable) - ((uint16_t)&__bss_end));
+  if ((uintptr_t)__brkval == 0)
+    return (((uintptr_t)&newVariable) - ((uintptr_t)&__bss_end));
   // use heap end as the start of the memory address
   else
-    return (((uint16_t)&newVariable) - ((uint16_t)__brkval));
+    return (((uintptr_t)&newVariable) - ((uintptr_t)__brkval));
 };
 
 int randomSeedValue = 0;
 
+static void resume(void);
+
 void setup() 
 {
+   // A match the watchdog cut short carries on where it was
+   if (Checkpoint.begin()) {
+      resume();
+      return;
+   }
+
+#if TRACE_RECORD
+   Serial.begin(TRACE_BAUD);
+#else
    Serial.begin(9600);
+#endif
    Wire.begin();
 
    Serial.print(F("FreeSram = "));
    Serial.println(getFreeSram());
+   Results.begin();
    
    // Randomize the random number generator by reading the A1 voltage
    //    and using that as a seed. Since A1 is floating, it's value is
@@ -97,41 +145,94 @@ void setup()
    //    *always* starts with the same value if not randomized first.
    randomSeedValue = analogRead(1);
    randomSeed(randomSeedValue);
+   Trace.begin(randomSeedValue);
+
+   // Input edges are stamped with the Timebase from here on
+   PinTrace.start();
+   Timebase.start();
 
    // Initialize processing for each stage
-   stage1.start();
-   stage2.start();
-   stage3.start();
+   stages.start();
 
    // Wait here until the START button is pressed, or return
    //   immediately if there is no LCD
    controller.start();
-   startTimestamp = millis();
+   Idle.start(controller.attached());
+   Clock.start(0);
+   Checkpoint.start(randomSeedValue);
+   Trace.event(TRACE_MATCH, controller.attached(), 0);
+}
+
+// Put every stage back as it was at the last checkpoint and carry on
+//    with the match, without the wait for START. The match time lost
+//    is the time since that checkpoint.
+static void resume(void)
+{
+#if TRACE_RECORD
+   Serial.begin(TRACE_BAUD);
+#else
+   Serial.begin(9600);
+#endif
+   Wire.begin();
+
+   Trace.resume();
+
+   const CheckpointData &saved = Checkpoint.saved();
+   randomSeedValue = saved.seed;
+   PinTrace.start();
+   Timebase.start();
+   stage1.resume(saved.relayIndex);
+   stage2.start();
+   stage2.resume(saved.stage2);
+   stage3.start();
+   stage3.resume(saved.stage3);
+   controller.resume();
+   Idle.start(controller.attached());
+
+   Clock.start(saved.matchTime);
+   Checkpoint.start(randomSeedValue);
+   Checkpoint.resumed();
+   Results.begin();
 }
 
-void loop() 
+ARENA_PROFILED void loop() 
 {  
-   uint32_t now = millis() - startTimestamp;
+   uint32_t now = Clock.sample();
    int score = 0;
 
+#if TRACE_RECORD
+   Trace.loop(now, controller.buttons());
+#endif
+
    // If the competition is still running, invoke each stage step (poor man's cooperative tasker)   
    if ((now < MATCH_RUNTIME) && (BTN_STOP != (controller.buttons() & BTN_STOP))) {
+      Checkpoint.step(now);
       controller.step(now);
-      stage1.step(now);
-      stage2.step(now);
-      stage3.step(now);
+      stages.step(now);
+      Console.poll(now);
+      Telemetry.step(now);
+
+#if IDLE_SLEEP
+      // Sleep until the next interrupt if no stage (and not the console)
+      //    has anything to do before then (see Idle.h)
+      cli();
+      if (stages.idle(now) && Console.idle()) {
+         Idle.sleep();
+      }
+      sei();
+#endif
       
    // Else the competition is over, so stop everything and report the results
    } else {
    
-      // Stop all the stage functions
+      // Stop all the stage functions, and the watchdog as the report
+      //    takes a while
+      Checkpoint.stop();
       controller.stop(now);
-      stage1.stop(now);
-      stage2.stop(now);
-      stage3.stop(now);
+      stages.stop(now);
  
       // Add up and print the total score (not counting stage 4, which is manual)     
-      score = stage1.score() + stage2.score() + stage3.score();
+      score = stages.score();
       Serial.print(F("------ RESULTS ------\n"));
       Serial.print(F("FINAL SCORE: "));
       Serial.print(score);
@@ -141,12 +242,25 @@ void loop()
       
       // Print out more detail on each stage
       controller.report(now, score);
-      stage1.report();
-      stage2.report();
-      stage3.report();
+      Checkpoint.report();
+      Idle.report(now);
+      Telemetry.report();
+      stages.report();
+
+      // Close the input trace with the scores it should reproduce
+      Trace.event(TRACE_SCORE, 2, stage2.score());
+      Trace.event(TRACE_SCORE, 3, stage3.score());
+      Trace.event(TRACE_END, 0, score);
+      Trace.flush();
+
+      // Keep the results in the EEPROM, now the match time is over
+      Results.save(randomSeedValue, now, score);
       
-      // Wait here forever
-      for(;;);
+      // Wait here forever, answering result log dumps
+      for (;;) {
+         Results.poll();
+         ARENA_HALT();
+      }
    }
  }
  
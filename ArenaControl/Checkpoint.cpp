@@ -0,0 +1,246 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Checkpoint.cpp
+ *
+ * This is the code file for the match checkpoint.
+ *
+ ********************************************************************/
+
+#include <avr/wdt.h>
+#include <util/crc16.h>
+
+#include "Arduino.h"
+#include "Checkpoint.h"
+#include "PinTrace.h"
+#include "Trace.h"
+
+#define WATCHDOG_MARK   0x5A
+
+/* Kept across a reset. The slots are plain words, so no constructor
+ *    runs over them at startup.
+ */
+static uint32_t slots[CHECKPOINT_SLOTS][(sizeof(CheckpointData) + 3) / 4] ARENA_NOINIT;
+static volatile uint8_t watchdogMark ARENA_NOINIT;
+
+#if CHECKPOINT_BOOT_CAUSE && defined(__AVR__)
+/* The reset cause optiboot passes in r2, saved before the C runtime
+ *    starts using the register
+ */
+static uint8_t bootCause ARENA_NOINIT;
+
+void saveBootCause(void) __attribute__((naked, used, section(".init0")));
+void saveBootCause(void)
+{
+   __asm__ __volatile__ ("sts %0, r2\n" : "=m" (bootCause) :);
+}
+#else
+#define bootCause 0
+#endif
+
+static CheckpointData &slot(uint8_t n);
+static uint16_t checkpointCrc(const CheckpointData &data);
+static boolean valid(const CheckpointData &data);
+
+
+MatchCheckpoint::MatchCheckpoint(Stage1 &stage1, Stage2 &stage2, Stage3 &stage3) :
+   stage1(stage1), stage2(stage2), stage3(stage3)
+{
+   seed = 0;
+   resumes = 0;
+   latest = 0;
+   number = 0;
+   lastSave = 0;
+   saveMax = 0;
+   recovery = 0;
+}
+
+
+/* First thing in setup() - true if the last match was cut short by the
+ *    watchdog (or a brownout, with CHECKPOINT_BOOT_CAUSE) and there is a
+ *    checkpoint of it to resume. A watchdog reset leaves the watchdog on
+ *    at its shortest timeout, so it is turned off here, well within the
+ *    16ms.
+ */
+boolean MatchCheckpoint::begin(void)
+{
+   boolean cut   = (WATCHDOG_MARK == watchdogMark) ||
+                   ((MCUSR | bootCause) & (bit(WDRF) | bit(BORF)));
+   boolean found = false;
+
+   MCUSR = 0;
+   wdt_disable();
+   watchdogMark = 0;
+
+   /* The newest good checkpoint */
+   for (uint8_t n=0; n < CHECKPOINT_SLOTS; n++) {
+      if (valid(slot(n)) && (!found || ((int16_t) (slot(n).number - slot(latest).number) > 0))) {
+         latest = n;
+         found = true;
+      }
+   }
+   if (cut && found) {
+      return true;
+   }
+
+   for (uint8_t n=0; n < CHECKPOINT_SLOTS; n++) {
+      slot(n).magic = 0;
+   }
+   return false;
+}
+
+
+/* The checkpoint begin() found */
+const CheckpointData &MatchCheckpoint::saved(void)
+{
+   return slot(latest);
+}
+
+
+/* The match starts (or carries on) - watchdog on, interrupt then reset */
+void MatchCheckpoint::start(int seed)
+{
+   this->seed = seed;
+#if CHECKPOINT
+   wdt_enable(WDTO_250MS);
+   WDTCSR |= bit(WDIE);
+#endif
+}
+
+
+/* The stages have been put back from the checkpoint. The time since
+ *    the reset is how long the recovery took. A checkpoint is taken
+ *    straight away, so the resume is counted even if the next reset
+ *    comes before the next checkpoint is due.
+ */
+void MatchCheckpoint::resumed(void)
+{
+   const CheckpointData &data = slot(latest);
+
+   recovery = micros();
+   number   = data.number;
+   resumes  = data.resumes + 1;
+   lastSave = data.matchTime;
+
+   Serial.print(F("RESUMED: match time "));
+   Serial.print(data.matchTime);
+   Serial.print(F(" ms, checkpoint #"));
+   Serial.print(data.number);
+   Serial.print(F(", recovery "));
+   Serial.print(recovery);
+   Serial.print(F(" us\n"));
+   Trace.flush();
+
+   save(data.matchTime);
+}
+
+
+/* Every loop() pass of the match - kick the watchdog, and take a
+ *    checkpoint when one is due
+ */
+void MatchCheckpoint::step(uint32_t timestamp)
+{
+   PIN_TRACE_STEP(PIN_TRACE_CHECKPOINT);
+
+#if CHECKPOINT
+   wdt_reset();
+   WDTCSR |= bit(WDIE);
+   watchdogMark = 0;
+
+   if ((0 == number) || ((timestamp - lastSave) >= CHECKPOINT_PERIOD)) {
+      save(timestamp);
+   }
+#endif
+}
+
+
+/* The match is over - nothing to resume any more */
+void MatchCheckpoint::stop(void)
+{
+   wdt_disable();
+   watchdogMark = 0;
+   for (uint8_t n=0; n < CHECKPOINT_SLOTS; n++) {
+      slot(n).magic = 0;
+   }
+}
+
+
+void MatchCheckpoint::report(void)
+{
+#if CHECKPOINT
+   Serial.print(F("CHECKPOINTS: "));
+   Serial.print(number);
+   Serial.print(F(", longest "));
+   Serial.print(saveMax);
+   Serial.print(F(" us\n"));
+   if (resumes) {
+      Serial.print(F("RESUMES: "));
+      Serial.print(resumes);
+      Serial.print(F(", recovery "));
+      Serial.print(recovery);
+      Serial.print(F(" us\n"));
+   }
+   Serial.print('\n');
+#endif
+}
+
+
+/* Write the next slot in turn - the other one still holds the last
+ *    checkpoint until this one has its CRC
+ */
+void MatchCheckpoint::save(uint32_t timestamp)
+{
+   uint32_t        began = micros();
+   CheckpointData &data  = slot(++number % CHECKPOINT_SLOTS);
+
+   data.magic       = CHECKPOINT_MAGIC;
+   data.number      = number;
+   data.resumes     = resumes;
+   data.matchTime   = timestamp;
+   data.seed        = seed;
+   data.relayIndex  = stage1.relayIndex;
+   stage2.checkpoint(data.stage2);
+   stage3.checkpoint(data.stage3);
+   data.crc         = checkpointCrc(data);
+
+   uint32_t took = micros() - began;
+   if (took > saveMax) {
+      saveMax = took;
+   }
+   lastSave = timestamp;
+}
+
+
+static CheckpointData &slot(uint8_t n)
+{
+   return *(CheckpointData *) slots[n];
+}
+
+
+/* CRC-CCITT of everything before the crc field */
+static uint16_t checkpointCrc(const CheckpointData &data)
+{
+   const uint8_t *p   = (const uint8_t *) &data;
+   const uint8_t *end = (const uint8_t *) &data.crc;
+   uint16_t       crc = 0xFFFF;
+
+   while (p < end) {
+      crc = _crc_ccitt_update(crc, *p++);
+   }
+   return crc;
+}
+
+
+static boolean valid(const CheckpointData &data)
+{
+   return (CHECKPOINT_MAGIC == data.magic) && (data.crc == checkpointCrc(data));
+}
+
+
+/* The loop has not kicked the watchdog for a whole timeout. Mark the
+ *    checkpoint for setup() - the reset follows one timeout later.
+ */
+ISR(WDT_vect)
+{
+   PIN_TRACE_ISR(PIN_TRACE_WATCHDOG);
+   watchdogMark = WATCHDOG_MARK;
+}
@@ -0,0 +1,82 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Checkpoint.h
+ *
+ * This is the header file for the match checkpoint.
+ *
+ * While a match runs, the watchdog is on and the state of every
+ * stage (the relay choice, the lightsaber duel, the knob and its
+ * digits so far) is copied every CHECKPOINT_PERIOD ms into RAM the
+ * C runtime does not clear at reset. If the sketch hangs, the
+ * watchdog interrupt marks the checkpoint and the watchdog reset
+ * follows; setup() finds the mark and a good checkpoint, and the
+ * match carries on from it instead of starting over. A brownout
+ * reset resumes the same way with CHECKPOINT_BOOT_CAUSE, which
+ * takes the reset cause the bootloader passes in r2 - optiboot
+ * clears MCUSR before the sketch can see it.
+ *
+ * Checkpoints go to two slots in turn, each with its own CRC, so
+ * a reset in the middle of writing one still leaves the other.
+ * The match time lost is the time since the last checkpoint plus
+ * the watchdog timeout - the outage itself is not counted as match
+ * time. How long the resume took, from the reset, is printed and
+ * reported with the results.
+ *
+ ********************************************************************/
+
+#ifndef Checkpoint_h
+#define Checkpoint_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Stage1.h"
+#include "Stage2.h"
+#include "Stage3.h"
+
+#define CHECKPOINT_MAGIC   0xA5C4
+#define CHECKPOINT_SLOTS   2
+
+/* One checkpoint */
+struct CheckpointData {
+   uint16_t    magic;
+   uint16_t    number;            // counts checkpoints in the match
+   uint8_t     resumes;           // times the match has been resumed
+   uint32_t    matchTime;         // ms, when it was taken
+   int16_t     seed;              // RANDOM SEED
+   uint16_t    relayIndex;
+   Stage2State stage2;
+   Stage3State stage3;
+   uint16_t    crc;               // of everything above
+};
+
+class MatchCheckpoint
+{
+   public:
+      MatchCheckpoint(Stage1 &stage1, Stage2 &stage2, Stage3 &stage3);
+
+      boolean begin(void);
+      const CheckpointData &saved(void);
+      void start(int seed);
+      void resumed(void);
+      void step(uint32_t timestamp);
+      void stop(void);
+      void report(void);
+
+   private:
+      void save(uint32_t timestamp);
+
+      Stage1  &stage1;
+      Stage2  &stage2;
+      Stage3  &stage3;
+      int      seed;
+      uint8_t  resumes;
+      uint8_t  latest;          // slot of the checkpoint resumed from
+      uint16_t number;          // of the last checkpoint
+      uint32_t lastSave;        // match time of the last checkpoint
+      uint32_t saveMax;         // us, longest checkpoint
+      uint32_t recovery;        // us from reset to resumed, 0 if not resumed
+};
+
+extern MatchCheckpoint Checkpoint;
+
+#endif
@@ -0,0 +1,139 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Console.cpp
+ *
+ * This is the code file for the in-match serial query console.
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Console.h"
+#include "PinTrace.h"
+#include "Quadrature.h"
+
+
+QueryConsole::QueryConsole(Stage2 &stage2, Stage3 &stage3) :
+   stage2(stage2), stage3(stage3)
+{
+   length = 0;
+   sent = 0;
+   passes = 0;
+   loopRate = 0;
+   second = 0;
+}
+
+
+/* Every loop() pass of the match - count the pass, send what fits of the
+ *    reply, then take the next command once the reply is all gone
+ */
+void QueryConsole::poll(uint32_t timestamp)
+{
+   PIN_TRACE_STEP(PIN_TRACE_CONSOLE);
+
+   int room;
+
+   if ((timestamp / MSECS) != second) {
+      second = timestamp / MSECS;
+      loopRate = passes;
+      passes = 0;
+   }
+   passes++;
+
+   if (sent < length) {
+      room = Serial.availableForWrite();
+      if (room > (length - sent)) {
+         room = length - sent;
+      }
+      if (room > 0) {
+         Serial.write((const uint8_t *) reply + sent, room);
+         sent += room;
+      }
+      return;
+   }
+
+   while (Serial.available()) {
+      char command = toupper(Serial.read());
+      if ((isalpha(command) || ('?' == command)) && strchr(CONSOLE_COMMANDS, command)) {
+         length = 0;
+         sent = 0;
+         answer(command, timestamp);
+         return;
+      }
+   }
+}
+
+
+/* Nothing for the console to do until an interrupt - no command waiting,
+ *    and no reply to send or no room for it until the transmit interrupt
+ *    has sent some
+ */
+boolean QueryConsole::idle(void)
+{
+   return !Serial.available() && ((sent == length) || (0 == Serial.availableForWrite()));
+}
+
+
+/* Add to the reply - anything past the end of the buffer is dropped, but
+ *    the last byte is kept for the line end
+ */
+size_t QueryConsole::write(uint8_t c)
+{
+   if (length >= (sizeof(reply) - 1)) {
+      return 0;
+   }
+   reply[length++] = c;
+   return 1;
+}
+
+
+void QueryConsole::answer(char command, uint32_t timestamp)
+{
+   switch (command) {
+      case 'E':
+         print(F("ENCODER: "));
+         print(Quadrature.read());
+         print(F(" decoded "));
+         print(stage3.position());
+         break;
+
+      case 'S':
+         print(F("SABER: "));
+         stage2.printState(*this);
+         print(F(" pattern "));
+         print(stage2.pattern());
+         break;
+
+      case 'G':
+         print(F("DIGITS: "));
+         stage3.printDigits(*this);
+         break;
+
+      case 'H':
+         print(F("HIT REPORT: ["));
+         print(stage2.hits());
+         print(']');
+         break;
+
+      case 'M':
+         print(F("FREE SRAM: "));
+         print(getFreeSram());
+         break;
+
+      case 'L':
+         print(F("LOOP RATE: "));
+         print(loopRate);
+         print(F("/s"));
+         break;
+
+      case 'T':
+         print(F("MATCH TIME: "));
+         print(timestamp);
+         print(F(" ms"));
+         break;
+
+      case '?':
+         print(F("E S G H M L T ?"));
+         break;
+   }
+   reply[length++] = '\n';
+}
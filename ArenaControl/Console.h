@@ -0,0 +1,74 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Console.h
+ *
+ * This is the header file for the in-match serial query console.
+ *
+ * While a match runs, a judge can send one letter commands on the
+ * serial port and get the answer back without stopping the match:
+ *
+ *    E   encoder count, and the position the decoder has seen
+ *    S   lightsaber state and fighting pattern
+ *    G   digits dialed so far (the last five, as they would score)
+ *    H   hit report so far
+ *    M   free SRAM
+ *    L   loop() passes in the last second of match time
+ *    T   match time
+ *    ?   the list of commands
+ *
+ * Case does not matter, and any other character (line endings and
+ * other letters included) is ignored. Before START and after the
+ * match the serial port is the result log's ('D' dumps it, see
+ * ResultLog.h).
+ *
+ * poll() runs once per loop() pass and never waits. It takes one
+ * command at a time, and only once the reply to the last one has
+ * gone - the rest wait in the serial receive buffer. A reply is
+ * printed into the console's own buffer (the console is a Print),
+ * and each pass moves as much of it to the serial port as fits in
+ * the transmit buffer without blocking. A reply that will not fit
+ * in CONSOLE_BUFFER is cut short.
+ *
+ ********************************************************************/
+
+#ifndef Console_h
+#define Console_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Stage2.h"
+#include "Stage3.h"
+
+#define CONSOLE_BUFFER   48
+#define CONSOLE_COMMANDS "ESGHMLT?"
+
+/* Free SRAM between the heap and the stack, in ArenaControl.ino */
+uint16_t getFreeSram();
+
+class QueryConsole : public Print
+{
+   public:
+      QueryConsole(Stage2 &stage2, Stage3 &stage3);
+
+      void poll(uint32_t timestamp);
+      boolean idle(void);
+
+      virtual size_t write(uint8_t c);
+      using Print::write;
+
+   private:
+      void answer(char command, uint32_t timestamp);
+
+      Stage2  &stage2;
+      Stage3  &stage3;
+      char     reply[CONSOLE_BUFFER];
+      uint8_t  length;          // of the reply
+      uint8_t  sent;            // bytes of it given to the serial port
+      uint16_t passes;          // loop() passes in this second
+      uint16_t loopRate;        // passes in the last whole second
+      uint32_t second;          // match time / 1000 of this second
+};
+
+extern QueryConsole Console;
+
+#endif
@@ -11,11 +11,14 @@
 
 #include "Arduino.h"
 #include "Controller.h"
+#include "PinTrace.h"
+#include "ResultLog.h"
 
 #define LCD_ADDRESS   0x27
 
 boolean lcdAttached = false;
 boolean initialDisplay = true;
+uint32_t drawnTenth = 0;      // match time / 100 of the last display update
 
 
 Sainsmart_I2CLCD lcd(LCD_ADDRESS,20,4);
@@ -64,12 +67,36 @@ void Controller::start()
     lcd.print("vvv");
     
     sequence = (sequence + 1) % 9;
+    Results.poll();
     delay(100);
   }
 
   lcd.clear();
   lcd.print("Match starting in...");
   initialDisplay = true;
+  drawnTenth = 0xFFFFFFFF;
+}
+
+/* Pick the controller up again for a match resumed from a checkpoint -
+ *    no splash screen and no wait for START, the running time display is
+ *    drawn again by the next step
+ */
+void Controller::resume()
+{
+  Wire.beginTransmission (LCD_ADDRESS);
+  lcdAttached = (0 == Wire.endTransmission ());
+  if (false == lcdAttached) {
+     return;
+  }
+
+  int b;
+  for (b=A0; b <= A3; b++) {  
+     pinMode(b, INPUT_PULLUP);
+  }
+
+  lcd.resume();
+  initialDisplay = true;
+  drawnTenth = 0xFFFFFFFF;
 }
 
 void Controller::stop(uint32_t timestamp)
@@ -82,9 +109,21 @@ void Controller::stop(uint32_t timestamp)
 
 void Controller::step(uint32_t timestamp)
 {
+   PIN_TRACE_STEP(PIN_TRACE_CONTROLLER);
+
    if (false == lcdAttached) {
       return;
    }
+
+   /* Nothing on the display changes until the next tenth of a second, so
+    *    the LCD is only written once per tenth - the I2C transfers of a 
+    *    full update take longer than the rest of the pass put together
+    */
+   uint32_t tenth = timestamp / 100;
+   if (!initialDisplay && (tenth == drawnTenth)) {
+      return;
+   }
+   drawnTenth = tenth;
    
    lcd.setCursor(0,2);
    
@@ -110,14 +149,14 @@ void Controller::step(uint32_t timestamp)
       lcd.setCursor(14,0);
       lcd.print((timestamp / MSECS) - COUNTDOWN_TIME);
       lcd.print(".");
-      lcd.print((timestamp/100) % 10);
+      lcd.print(tenth % 10);
 
       lcd.setCursor(15,2);
-      lcd.print((timestamp % 300) ? "STOP" : "    ");
+      lcd.print((tenth % 3) ? "STOP" : "    ");
     
       lcd.setCursor(13,3);
       lcd.print("      ");
-      lcd.setCursor(14+(timestamp%900)/300,3);
+      lcd.setCursor(14+(tenth%9)/3,3);
       lcd.print("vvv");
    }
 }
@@ -125,27 +164,33 @@ void Controller::step(uint32_t timestamp)
 
 void Controller::report(uint32_t timestamp, int score)
 {
-   if (false == lcdAttached) {
-      return;
-   }
-   
    uint32_t runTime = 0;
 
    /* If we are still in the countdown, set the run time to 0 */   
    if (timestamp < COUNTDOWN_TIME * MSECS) {
       runTime = 0;
       
-   /* Else deduct the countdown time and round up to nearest second */
+   /* Else deduct the countdown time */
    } else {
-      runTime = timestamp - (COUNTDOWN_TIME * MSECS) + (MSECS / 2);
+      runTime = timestamp - (COUNTDOWN_TIME * MSECS);
+   }
+
+   /* The run time goes in the serial results too, in msecs */
+   Serial.print(F("RUN TIME: "));
+   Serial.print(runTime);
+   Serial.print(F("\n\n"));
+
+   if (false == lcdAttached) {
+      return;
    }
    
+   /* Rounded to the nearest second on the LCD */
    lcd.clear();
    lcd.print("SCORE:");
    lcd.print(score);
    lcd.setCursor(11,0);
    lcd.print("TIME:");
-   lcd.print(runTime / MSECS);
+   lcd.print((runTime + (MSECS / 2)) / MSECS);
 }
 
 
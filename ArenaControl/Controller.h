@@ -25,8 +25,9 @@ class Controller
       Controller(uint8_t lcd_Addr=0x27, uint8_t lcd_cols=40, uint8_t lcd_rows=4);
       
       void start();
+      void resume();
       void stop(uint32_t timestamp);
-      void step(uint32_t timestamp);
+      ARENA_PROFILED void step(uint32_t timestamp);
       void report(uint32_t timestamp, int score);
 
       boolean attached();
@@ -0,0 +1,203 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - DigitDecoder.cpp
+ *
+ * This is the code file for the stage #3 digit decoder. 
+ *
+ ********************************************************************/
+
+#include "DigitDecoder.h"
+
+#define NOT_MOVED (4269)        // 6*9 = 42, in base 13, Hitchiker's Guide to the Galaxy
+
+
+DigitDecoder::DigitDecoder()
+{
+   reset();
+}
+
+
+void DigitDecoder::reset(long position)
+{
+   /* The only division - split the starting position into whole turns
+    *    and the offset within the revolution, in (-REV/2, +REV/2]
+    */
+   wholeTurns         = position / ONE_REVOLUTION;
+   revolution         = position % ONE_REVOLUTION;
+   if (revolution > (ONE_REVOLUTION/2)) {
+      revolution -= ONE_REVOLUTION;
+      wholeTurns++;
+   } else if (revolution <= -(ONE_REVOLUTION/2)) {
+      revolution += ONE_REVOLUTION;
+      wholeTurns--;
+   }
+
+   current            = position;
+   prevCenter         = true;
+   hasMoved           = false;
+   prevTurns          = 0;
+   prevPosition       = NOT_MOVED;
+   enteringClockwise  = true;
+   exitingClockwise   = false;
+   lastDigitClockwise = true;
+   digitCounter       = 0;
+}
+
+
+/* Consume the next encoder position, walking every count between the
+ *    last position and this one. Returns the number of digits that were
+ *    completed along the way.
+ */
+uint8_t DigitDecoder::feed(long position)
+{
+   uint8_t added = 0;
+
+   /* Walk clockwise, wrapping the in-revolution offset into the next turn */
+   while (current < position) {
+      current++;
+      if (++revolution > (ONE_REVOLUTION/2)) {
+         revolution -= ONE_REVOLUTION;
+         wholeTurns++;
+      }
+      added += step();
+   }
+
+   /* Walk counterclockwise */
+   while (current > position) {
+      current--;
+      if (--revolution <= -(ONE_REVOLUTION/2)) {
+         revolution += ONE_REVOLUTION;
+         wholeTurns--;
+      }
+      added += step();
+   }
+
+   return added;
+}
+
+
+/* If we are resting in the center and have moved, then the final digit
+ *    was never 'exited', so add it now. Returns true if a digit was added.
+ */
+bool DigitDecoder::finish(void)
+{
+   if (hasMoved && prevCenter) {
+      addDigit();
+      return true;
+   }
+   return false;
+}
+
+
+/* Return the most recently entered digit */
+uint8_t DigitDecoder::lastDigit(void) const
+{
+   return digits[(digitCounter + MAX_DIGITS_STORED - 1) % MAX_DIGITS_STORED];
+}
+
+
+/* Copy the last (up to) 'n' digits, oldest first, into 'out' and return
+ *    the number of digits copied
+ */
+uint8_t DigitDecoder::lastDigits(uint8_t *out, uint8_t n) const
+{
+   uint8_t loop;
+
+   if (n > MAX_DIGITS_STORED) n = MAX_DIGITS_STORED;
+   if (n > digitCounter)      n = digitCounter;
+
+   for (loop=0; loop < n; loop++) {
+      out[loop] = digits[(digitCounter - n + loop) % MAX_DIGITS_STORED];
+   }
+
+   return n;
+}
+
+
+/* Process a single count of motion, with the revolution offset and turns
+ *  already updated for the new position
+ *
+ *  We really only care if we are transitioning into, or out of, a center - no
+ *  other motion counts. This allows the robot to move the quadrature back and 
+ *  forth and all that motion is filtered out - until we cross a center.
+ *  
+ *  Once we cross into a center we need to store the the number of turns and
+ *  a flag indicating if we entered it clockwise or counterclockwise
+ *  
+ *  Once we exit a center, if we exit it in the same direction we entered it,
+ *  we have nothing to do (just continuing motion in the same direction). However,
+ *  if we exit it in a different direction than we entered, we are entering a
+ *  digit. The only extra issue here is to verify we are entereing digits in a
+ *  clockwise, counterclockwise sequence.
+ *  
+ *  Note that if we start off moving in a counterclockwize direction the first
+ *  time, we are lost, and the system will not recover - this is an error state
+ *  as defined in the rules (must start clockwise).
+ */
+bool DigitDecoder::step(void)
+{
+   bool center = (revolution >= -PLUS_MINUS) && (revolution <= PLUS_MINUS);
+   bool added = false;
+
+   /* Nothing to do unless we crossed a center boundary */
+   if (center == prevCenter) {
+      return false;
+   }
+
+   /* did we just transition into center on this step? Entering below the
+    *    whole turn means we were turning clockwise
+    */
+   if (center) {
+      enteringClockwise = (revolution < 0);
+      prevTurns = wholeTurns;
+
+   /* else we just transitioned out of the center on this step. The center
+    *    window is narrower than half a turn, so 'wholeTurns' is still the
+    *    turn we entered at and the sign of the offset gives the direction
+    */
+   } else {
+      hasMoved = true;
+      exitingClockwise = (revolution > 0);
+
+      /* If we entered, then exited the center in opposite directions
+       * then we have just dialed a digit. However, we only count digits
+       * entered in alternating clockwise and counterclockwise directions
+       */
+      if ((enteringClockwise != exitingClockwise) &&
+          (lastDigitClockwise != exitingClockwise)) {
+         addDigit();
+         added = true;
+      }
+   }
+
+   /* Save our previous center state for our next time */
+   prevCenter = center;
+   return added;
+}
+
+
+/* This handles the logic of adding a digit, calculating the digit value
+ *  from the current and previous positions.
+ */
+void DigitDecoder::addDigit(void)
+{
+   uint8_t *digit = &digits[digitCounter % MAX_DIGITS_STORED];
+
+   /* If this is the first digit, the digit is just the number of turns */
+   if (prevPosition == NOT_MOVED) {
+      *digit = prevTurns;
+
+   /* Else we need to subtract the last position to get the delta number of
+    *  turns. We have two cases here - traveling clockwise or counterclockwise
+    */
+   } else if (enteringClockwise) {
+      *digit = prevTurns - prevPosition;
+   } else {
+      *digit = prevPosition - prevTurns;
+   }
+
+   /* Update our variables for the next digit */
+   lastDigitClockwise = exitingClockwise;
+   prevPosition = prevTurns;
+   digitCounter++;
+}
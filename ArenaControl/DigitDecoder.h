@@ -0,0 +1,77 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - DigitDecoder.h
+ *
+ * This is the header file for the stage #3 digit decoder. 
+ *
+ * The digit decoder turns a stream of quadrature encoder positions
+ * into the digits dialed on the stage 3 knob. It has no Arduino
+ * dependencies, so the same code runs in the sketch and on a host
+ * against recorded or synthetic encoder traces.
+ *
+ * Positions do not need to arrive one count at a time - when the
+ * position jumps by more than one count between two calls to feed(),
+ * the decoder walks every intermediate count so that no crossing of
+ * a center region is missed, however slowly the caller samples.
+ *
+ * The position within the current revolution and the number of whole
+ * turns are tracked incrementally as each count is walked, so the
+ * decoder never needs to divide a 32-bit position.
+ *
+ ********************************************************************/
+
+#ifndef DigitDecoder_h
+#define DigitDecoder_h
+
+#include <stdint.h>
+
+#include "QuadratureTable.h"
+
+/* Encoder counts in one turn of the knob, and the +/- counts from a whole
+ *    turn that are 'center' - both follow QUADRATURE_RESOLUTION (96 and 6
+ *    at x4 resolution)
+ */
+#define ONE_REVOLUTION  (EncoderTable::revolution)
+#define ONE_CLICK       (QUADRATURE_RESOLUTION)
+#define TWO_CLICKS      (2 * ONE_CLICK)
+#define PLUS_MINUS      (EncoderTable::center)
+
+#define MAX_DIGITS_STORED 32    // Maximum number of digits (only last 5 count)
+
+class DigitDecoder
+{
+   public:
+      DigitDecoder();
+
+      void    reset(long position = 0);
+      uint8_t feed(long position);
+      uint8_t feedDelta(int delta) { return feed(current + delta); }
+      bool    finish(void);
+
+      long    position(void) const { return current; }
+      int     turns(void) const { return wholeTurns; }
+      bool    inCenter(void) const { return prevCenter; }
+      bool    moved(void) const { return hasMoved; }
+      uint16_t count(void) const { return digitCounter; }
+      uint8_t lastDigit(void) const;
+      uint8_t lastDigits(uint8_t *out, uint8_t n) const;
+
+   private:
+      bool    step(void);
+      void    addDigit(void);
+
+      long    current;              // last position walked
+      int8_t  revolution;           // position relative to the nearest whole turn
+      int     wholeTurns;           // nearest whole turn (current = turns*REV + revolution)
+      bool    prevCenter;           // were we in the center at the last position?
+      bool    hasMoved;             // have we ever left the starting center?
+      int     prevTurns;            // number of turns at the last center entered
+      int     prevPosition;         // turns at the last digit entered
+      bool    enteringClockwise;    // did we enter center in a clockwise direction?
+      bool    exitingClockwise;     // did we exit center in a clockwise direction?
+      bool    lastDigitClockwise;   // was last digit entered in clockwise direction?
+      uint16_t digitCounter;        // number of digits entered
+      uint8_t digits[MAX_DIGITS_STORED];  // wrap-around buffer of the digits entered
+};
+
+#endif
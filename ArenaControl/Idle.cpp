@@ -0,0 +1,86 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Idle.cpp
+ *
+ * This is the code file for the idle sleep between events.
+ *
+ ********************************************************************/
+
+#include <avr/sleep.h>
+
+#include "Arduino.h"
+#include "Idle.h"
+#include "PinTrace.h"
+#include "SimplePinChange.h"
+#include "Timebase.h"
+
+IdleSleep Idle;
+
+static void buttonWake(void);
+
+
+IdleSleep::IdleSleep()
+{
+   sleeps = 0;
+   asleep = 0;
+   longest = 0;
+}
+
+
+/* Idle mode, and a pin change interrupt on the controller buttons (if
+ *    there is a controller) so a press wakes the CPU
+ */
+void IdleSleep::start(boolean buttons)
+{
+   set_sleep_mode(SLEEP_MODE_IDLE);
+
+   if (buttons) {
+      for (uint8_t b=A0; b <= A3; b++) {
+         SimplePinChange.attach(b, buttonWake);
+      }
+   }
+}
+
+
+/* Called with interrupts off - sleep until the next interrupt has run.
+ *    sei() holds interrupts off for the instruction after it, so one
+ *    already pending wakes the CPU straight away.
+ */
+void IdleSleep::sleep(void)
+{
+   uint32_t began = Timebase.ticks();
+   uint32_t slept;
+
+   sleep_enable();
+   sei();
+   sleep_cpu();
+   sleep_disable();
+
+   slept = Timebase.ticks() - began;
+   asleep += slept;
+   if (slept > longest) {
+      longest = slept;
+   }
+   sleeps++;
+}
+
+
+void IdleSleep::report(uint32_t timestamp)
+{
+#if IDLE_SLEEP
+   Serial.print(F("IDLE: "));
+   Serial.print(sleeps);
+   Serial.print(F(" sleeps, "));
+   Serial.print(timestamp ? asleep / (timestamp * (TIMEBASE_TICKS_PER_MS / 100)) : 0);
+   Serial.print(F("% asleep, longest "));
+   Serial.print(longest / TIMEBASE_TICKS_PER_US);
+   Serial.print(F(" us\n\n"));
+#endif
+}
+
+
+/* The buttons are read by the controller - this only wakes the CPU */
+static void buttonWake(void)
+{
+   PIN_TRACE_ISR(PIN_TRACE_BUTTONS);
+}
@@ -0,0 +1,52 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Idle.h
+ *
+ * This is the header file for the idle sleep between events.
+ *
+ * Once a loop() pass of the match has done what its stages had to
+ * do, and none of them has anything left until an input or a timer
+ * comes along (see StageList idle()), the CPU sleeps in the idle
+ * mode until the next interrupt. Every peripheral keeps running, so
+ * everything that gives a stage work wakes it:
+ *
+ *    vibration sensor    INT0
+ *    encoder             PCINT2 (or the Timer2 sampling interrupt)
+ *    buttons A0-A3       PCINT1, attached here only to wake the CPU
+ *    match time          Timer0 overflow, every 1.024ms
+ *
+ * so a match time deadline is overslept by at most one Timer0
+ * period, and an input is seen as soon as its interrupt routine has
+ * run. The check and the sleep are done with interrupts off, and
+ * interrupts only come back on with the sleep instruction, so an
+ * interrupt that comes in between cannot be slept through.
+ *
+ * The time asleep and the longest sleep are measured on the
+ * Timebase, and reported with the results.
+ *
+ ********************************************************************/
+
+#ifndef Idle_h
+#define Idle_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+
+class IdleSleep
+{
+   public:
+      IdleSleep();
+
+      void start(boolean buttons);
+      void sleep(void);
+      void report(uint32_t timestamp);
+
+   private:
+      uint32_t sleeps;
+      uint32_t asleep;          // Timebase ticks, in all
+      uint32_t longest;         // Timebase ticks
+};
+
+extern IdleSleep Idle;
+
+#endif
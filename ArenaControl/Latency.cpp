@@ -0,0 +1,123 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Latency.cpp
+ *
+ * This is the code file for the input-to-output latency
+ * measurement. 
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Latency.h"
+
+
+LatencyPath::LatencyPath()
+{
+   inputTime = 0;
+   pending   = false;
+   count     = 0;
+   minimum   = 0xFFFFFFFF;
+   maximum   = 0;
+   total     = 0;
+   memset(histogram, 0, sizeof(histogram));
+}
+
+
+/* The visible response has been produced, so close out the pending
+ *    measurement (if any) and fold it into the statistics
+ */
+void LatencyPath::output(void)
+{
+#if LATENCY_STATS
+   uint32_t latency;
+   uint8_t  bucket = 0;
+
+   /* Grab the start time with interrupts off, as the ISR can update it */
+   noInterrupts();
+   if (!pending) {
+      interrupts();
+      return;
+   }
+   latency = micros() - inputTime;
+   pending = false;
+   interrupts();
+
+   if (latency < minimum) minimum = latency;
+   if (latency > maximum) maximum = latency;
+   total += latency;
+
+   /* Bucket 'n' holds latencies in [2^(n-1), 2^n) microseconds */
+   while ((latency > 0) && (bucket < (LATENCY_BUCKETS-1))) {
+      latency >>= 1;
+      bucket++;
+   }
+   if (0xFFFF == histogram[bucket]) {
+      for (uint8_t n=0; n < LATENCY_BUCKETS; n++) {
+         histogram[n] >>= 1;
+      }
+   }
+   histogram[bucket]++;
+   count++;
+#endif
+}
+
+
+/* The input was consumed without a visible response (ignored hits, or 
+ *    encoder motion that netted out to zero), so drop the measurement
+ */
+void LatencyPath::cancel(void)
+{
+#if LATENCY_STATS
+   pending = false;
+#endif
+}
+
+
+/* Print the statistics for this path. The p99 value is the upper bound
+ *    of the histogram bucket that contains the 99th percentile sample,
+ *    counted against the histogram's own total, which is less than
+ *    count once it has been halved.
+ */
+void LatencyPath::report(const __FlashStringHelper *name)
+{
+#if LATENCY_STATS
+   uint32_t cumulative = 0;
+   uint32_t samples = 0;
+   uint8_t  bucket;
+
+   Serial.print(F("LATENCY "));
+   Serial.print(name);
+   Serial.print(F(": n="));
+   Serial.print(count);
+
+   if (0 == count) {
+      Serial.print(F("\n"));
+      return;
+   }
+
+   for (bucket=0; bucket < LATENCY_BUCKETS; bucket++) {
+      samples += histogram[bucket];
+   }
+   for (bucket=0; bucket < (LATENCY_BUCKETS-1); bucket++) {
+      cumulative += histogram[bucket];
+      if ((cumulative * 100) >= (samples * 99)) {
+         break;
+      }
+   }
+
+   Serial.print(F(" min="));
+   Serial.print(minimum);
+   Serial.print(F("us max="));
+   Serial.print(maximum);
+   Serial.print(F("us mean="));
+   Serial.print(total / count);
+   if (bucket < (LATENCY_BUCKETS-1)) {
+      Serial.print(F("us p99<"));
+      Serial.print(1UL << bucket);
+   } else {
+      Serial.print(F("us p99>="));
+      Serial.print(1UL << (bucket-1));
+   }
+   Serial.print(F("us\n"));
+#endif
+}
@@ -0,0 +1,63 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Latency.h
+ *
+ * This is the header file for the input-to-output latency
+ * measurement.
+ *
+ * A latency path is started by an input edge (from within the
+ * interrupt routine) and finished when the arena produces the
+ * visible response to that input (a lightsaber flash, or the
+ * quadrature LED colour update). Only the first edge of a burst
+ * starts a measurement - further edges that arrive before the
+ * response is shown are part of the same event.
+ *
+ * Statistics are kept as min/max/mean and a log2 histogram of
+ * the latency in microseconds, which is used to estimate the p99
+ * value without storing every sample. A bucket about to overflow
+ * halves the whole histogram, so a long run keeps the shape of the
+ * distribution (the p99) rather than wrapping.
+ *
+ ********************************************************************/
+
+#ifndef Latency_h
+#define Latency_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+
+/* Number of log2 histogram buckets - the last bucket holds anything
+ *    of 2^(LATENCY_BUCKETS-1) microseconds (~32ms) or more
+ */
+#define LATENCY_BUCKETS  16
+
+class LatencyPath
+{
+   public:
+      LatencyPath();
+
+      /* Called from the interrupt routine on an input edge */
+      inline void input(void) {
+#if LATENCY_STATS
+         if (!pending) {
+            inputTime = micros();
+            pending = true;
+         }
+#endif
+      }
+
+      void output(void);
+      void cancel(void);
+      void report(const __FlashStringHelper *name);
+
+   private:
+      volatile uint32_t inputTime;
+      volatile boolean  pending;
+      uint32_t count;
+      uint32_t minimum;
+      uint32_t maximum;
+      uint32_t total;
+      uint16_t histogram[LATENCY_BUCKETS];
+};
+
+#endif
@@ -0,0 +1,31 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - MatchClock.cpp
+ *
+ * This is the code file for the match clock.
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "MatchClock.h"
+
+MatchClock Clock;
+
+
+MatchClock::MatchClock()
+{
+   origin = 0;
+   time = 0;
+   stamp = 0;
+}
+
+
+/* The match time is 'matchTime' now - 0 at the start of a match, or
+ *    where a resumed match left off
+ */
+void MatchClock::start(uint32_t matchTime)
+{
+   origin = (uint32_t) MATCH_CLOCK_SOURCE() - matchTime;
+   time = matchTime;
+   stamp = Timebase.ticks();
+}
@@ -0,0 +1,66 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - MatchClock.h
+ *
+ * This is the header file for the match clock.
+ *
+ * Match time is ms since the match started, countdown included.
+ * loop() samples it once at the top of each pass and hands the
+ * same value to every stage, so the stages (and the two countdown
+ * displays, the LCD and the lightsaber) all change phase on the
+ * same pass, and the clock is read with interrupts off once per
+ * pass instead of once per use.
+ *
+ * The clock source is MATCH_CLOCK_SOURCE() (ArenaControl.h),
+ * millis() unless a build says otherwise - a time-scaled clock for
+ * a quick run through a whole match on the bench, say. The host
+ * simulator needs nothing different, as its millis() runs off the
+ * virtual clock.
+ *
+ * Each sample also stamps the Timebase, so an input edge stamped in
+ * Timebase ticks can be put in match time by how long before the
+ * sample it came. Every deadline is match time, so a scaled clock
+ * scales the whole match; only that short gap is real time.
+ *
+ ********************************************************************/
+
+#ifndef MatchClock_h
+#define MatchClock_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Timebase.h"
+
+class MatchClock
+{
+   public:
+      MatchClock();
+
+      void start(uint32_t matchTime);
+
+      /* Read the source - once per loop() pass */
+      inline uint32_t sample(void) {
+         time  = (uint32_t) MATCH_CLOCK_SOURCE() - origin;
+         stamp = Timebase.ticks();
+         return time;
+      }
+
+      /* The match time of the last sample */
+      inline uint32_t now(void) {
+         return time;
+      }
+
+      /* The Timebase ticks of the last sample */
+      inline uint32_t ticks(void) {
+         return stamp;
+      }
+
+   private:
+      uint32_t origin;          // source time of match time 0
+      uint32_t time;            // last sample
+      uint32_t stamp;           // Timebase ticks of the last sample
+};
+
+extern MatchClock Clock;
+
+#endif
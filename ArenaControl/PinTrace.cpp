@@ -0,0 +1,24 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - PinTrace.cpp
+ *
+ * This is the code file for the logic analyzer timing trace.
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "PinTrace.h"
+
+PinTraceClass PinTrace;
+
+
+/* Both trace pins low outputs, before any marked interrupt is enabled */
+void PinTraceClass::start(void)
+{
+#if PIN_TRACE
+   digitalWrite(PIN_TRACE_ISR_PIN, LOW);
+   digitalWrite(PIN_TRACE_STEP_PIN, LOW);
+   pinMode(PIN_TRACE_ISR_PIN, OUTPUT);
+   pinMode(PIN_TRACE_STEP_PIN, OUTPUT);
+#endif
+}
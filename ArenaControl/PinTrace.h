@@ -0,0 +1,133 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - PinTrace.h
+ *
+ * This is the header file for the logic analyzer timing trace.
+ *
+ * With PIN_TRACE set, the spare pins D11 and D12 (on the external
+ * I/O header) show where the CPU time goes, for a logic analyzer:
+ *
+ *    D11   high while one of the sketch's interrupt routines runs
+ *    D12   high while one of the steps of a loop() pass runs
+ *
+ * Each window opens with a short pulse train that tells which
+ * routine or step it is - source n gives n rising edges, the last
+ * of which opens the window:
+ *
+ *    D11   1 encoder (pin change, or the sampling timer)
+ *          2 vibration hit
+ *          3 Timebase overflow
+ *          4 watchdog
+ *          5 button wake (idle sleep)
+ *    D12   1 checkpoint    2 controller    3 stage 1    4 stage 2
+ *          5 stage 3       6 console       7 telemetry
+ *
+ * The steps are marked in the order a pass runs them, so a D12
+ * burst is a loop() pass, and the gap after it is the idle sleep
+ * or the next pass. A D11 window inside a D12 one is an interrupt
+ * taken during that step. The pins are set and cleared with single
+ * sbi/cbi instructions (2 cycles each), and the pulse train goes out
+ * with interrupts off, so its pulses are always 125ns high and 125ns
+ * low - a 24MHz analyzer resolves them - and a low of more than 3
+ * cycles ends the train. A window costs about 8 cycles, plus 4 for
+ * each extra pulse. The Arduino core's own interrupts (millis(),
+ * serial, I2C) are not marked; their time shows up inside whatever
+ * window they interrupt.
+ *
+ * A routine is marked with PIN_TRACE_ISR(n) or PIN_TRACE_STEP(n)
+ * as its first statement, and the window closes however the
+ * routine returns. With PIN_TRACE 0 (the default) the marks are
+ * empty and D11/D12 are left alone.
+ *
+ * The host simulator writes the same pin changes for a simulated
+ * match (arenasim -p), and HostTools/pinvcd turns them into a VCD
+ * file for a waveform viewer (GTKWave, PulseView).
+ *
+ ********************************************************************/
+
+#ifndef PinTrace_h
+#define PinTrace_h
+
+#include <util/atomic.h>
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+
+#define PIN_TRACE_ISR_PIN     11    // PB3
+#define PIN_TRACE_STEP_PIN    12    // PB4
+#define PIN_TRACE_ISR_BIT     3
+#define PIN_TRACE_STEP_BIT    4
+
+/* D11 sources */
+#define PIN_TRACE_ENCODER     1
+#define PIN_TRACE_VIBRATE     2
+#define PIN_TRACE_TIMEBASE    3
+#define PIN_TRACE_WATCHDOG    4
+#define PIN_TRACE_BUTTONS     5
+
+/* D12 sources */
+#define PIN_TRACE_CHECKPOINT  1
+#define PIN_TRACE_CONTROLLER  2
+#define PIN_TRACE_STAGE1      3
+#define PIN_TRACE_STAGE2      4
+#define PIN_TRACE_STAGE3      5
+#define PIN_TRACE_CONSOLE     6
+#define PIN_TRACE_TELEMETRY   7
+
+class PinTraceClass
+{
+   public:
+      static void start(void);
+};
+
+/* The call into a marked routine, which the host simulator does not
+ *    otherwise count - it defines this to run its clock on. Nothing on
+ *    the arena, where the call takes its own cycles.
+ */
+#ifndef PIN_TRACE_ENTRY
+#define PIN_TRACE_ENTRY()
+#endif
+
+/* The window of one routine - the pulse train and the rising edge
+ *    when it is constructed, the falling edge when it goes out of
+ *    scope. Bit and Code are constants, so every write is one sbi or
+ *    cbi, and the train is unrolled.
+ */
+template <uint8_t Bit, uint8_t Code>
+class PinTraceMark
+{
+   public:
+      inline PinTraceMark() {
+         PIN_TRACE_ENTRY();
+         ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            pulses<Code - 1>();
+            PORTB |= (uint8_t) _BV(Bit);
+         }
+      }
+
+      inline ~PinTraceMark() {
+         PORTB &= (uint8_t) ~_BV(Bit);
+      }
+
+   private:
+      template <uint8_t Count>
+      static inline void pulses(void) {
+         if (Count) {
+            PORTB |= (uint8_t) _BV(Bit);
+            PORTB &= (uint8_t) ~_BV(Bit);
+            pulses<Count ? Count - 1 : 0>();
+         }
+      }
+};
+
+#if PIN_TRACE
+#define PIN_TRACE_ISR(code)    PinTraceMark<PIN_TRACE_ISR_BIT, code> pinTraceMark
+#define PIN_TRACE_STEP(code)   PinTraceMark<PIN_TRACE_STEP_BIT, code> pinTraceMark
+#else
+#define PIN_TRACE_ISR(code)
+#define PIN_TRACE_STEP(code)
+#endif
+
+extern PinTraceClass PinTrace;
+
+#endif
@@ -0,0 +1,239 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Quadrature.cpp
+ *
+ * This is the code file for the stage #3 quadrature encoder
+ * decoder. 
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Quadrature.h"
+#include "PinTrace.h"
+#include "QuadratureTable.h"
+#include "Timebase.h"
+#include "Trace.h"
+
+/* PIND bits for the two channels, and the shift that moves them into 
+ *    bits 2 (channel A) and 3 (channel B) of the 4-bit table index
+ */
+#define ENCODER_A_BIT     3
+#define ENCODER_B_BIT     4
+#define ENCODER_SHIFT     1
+#define ENCODER_MASK      0x0C
+
+/* Furthest the live count may be from the checkpointed one at a resume -
+ *    a knob at the 4k edges/sec blackout limit (see the PCINT2 interrupt)
+ *    for a checkpoint period and the 250ms watchdog timeout, with some
+ *    to spare
+ */
+#define RESUME_SLACK      2000L
+
+QuadratureClass Quadrature;
+LatencyPath encoderLatency;
+
+volatile long     QuadratureClass::value ARENA_NOINIT;
+volatile uint32_t QuadratureClass::edge = 0;
+volatile uint8_t  QuadratureClass::sequence = 0;
+static uint8_t oldState ARENA_NOINIT;           // previous quadrature pin state (bits 0,1)
+
+/* The count and pin state the interrupt left before the last reset, and
+ *    the pin state start() found
+ */
+static long    carriedValue;
+static uint8_t carriedState;
+static uint8_t startState;
+
+
+/* Decode the current pin state - shared by both decoding modes. Both
+ *    channels are read with a single PIND read and shifted straight into
+ *    the table index. 
+ */
+static inline void decode(void)
+{
+   uint8_t state = oldState | ((PIND >> ENCODER_SHIFT) & ENCODER_MASK);
+   int8_t  change = EncoderTable::stateChange[state];
+
+   oldState = state >> 2;
+
+#if TRACE_RECORD
+   /* Trace every change of the pins, even one the table counts as 0 */
+   if (oldState != (state & 3)) {
+      Trace.input(TRACE_ENCODER, oldState, QuadratureClass::value + change);
+   }
+#endif
+
+#if (QUADRATURE_MODE == QUADRATURE_SAMPLED)
+   /* Most samples see no motion - skip the 32-bit update for those */
+   if (0 == change) {
+      return;
+   }
+#endif
+
+   QuadratureClass::value += change;
+   QuadratureClass::edge   = Timebase.ticks();
+   QuadratureClass::sequence++;
+
+   encoderLatency.input();
+}
+
+
+void QuadratureClass::start(void)
+{
+   /* Set both quadrature channels to input and turn on pullup resistors */
+   pinMode(ENCODER_A_PIN, INPUT_PULLUP); 
+   pinMode(ENCODER_B_PIN, INPUT_PULLUP);
+
+   /* Keep what the interrupt left for resume(), then get the initial
+    *    state of the two quadrature pins
+    */
+   carriedValue = value;
+   carriedState = oldState;
+   startState = (PIND >> ENCODER_A_BIT) & 3;
+   oldState = startState;
+   value = 0;
+
+#if (QUADRATURE_MODE == QUADRATURE_SAMPLED)
+   /* Timer2 in CTC mode, /8 prescaler (2MHz), interrupting on compare
+    *    match A at QUADRATURE_SAMPLE_HZ
+    */
+   TCCR2A = bit(WGM21);
+   TCCR2B = bit(CS21);
+   OCR2A  = (F_CPU / 8 / QUADRATURE_SAMPLE_HZ) - 1;
+   TCNT2  = 0;
+   TIFR2  = bit(OCF2A);
+   TIMSK2 = bit(OCIE2A);
+#else
+   /* Unmask the channels in PCINT2 (pins 0-7), clearing any stale flag
+    *    before the port interrupt is enabled. Only x4 decoding needs the
+    *    edges of channel B.
+    */
+   PCMSK2 |= bit(ENCODER_A_BIT) | (EncoderTable::channelB ? bit(ENCODER_B_BIT) : 0);
+   PCIFR   = bit(PCIF2);
+   PCICR  |= bit(PCIE2);
+#endif
+}
+
+
+/* Carry on counting after a watchdog reset, once start() has run. The
+ *    interrupt keeps its count in RAM the C runtime leaves alone, so it
+ *    is up to date to the last edge before the reset, where the one in
+ *    the checkpoint can be CHECKPOINT_PERIOD and the watchdog timeout
+ *    old. It is taken if it is within RESUME_SLACK of the checkpointed
+ *    count - further than the knob can turn in that time means the RAM
+ *    did not survive - and the pins are decoded against the state it
+ *    last saw, so one edge missed while the sketch restarted still
+ *    counts. Otherwise the count carries on from the checkpoint. The
+ *    counts since start() are added either way, and the count and the
+ *    pins go in the RESUME trace record. True if the interrupt's count
+ *    was taken.
+ */
+boolean QuadratureClass::resume(long checkpointed)
+{
+   boolean live = ((uint32_t) (carriedValue - checkpointed + RESUME_SLACK) <= (2 * RESUME_SLACK)) &&
+                  (carriedState < 4);
+   long    base = live ? carriedValue + EncoderTable::stateChange[carriedState | (startState << 2)] :
+                         checkpointed;
+
+   noInterrupts();
+   value += base;
+   sequence++;
+   Trace.resumed(startState, value);
+   interrupts();
+   return live;
+}
+
+
+void QuadratureClass::stop(void)
+{
+#if (QUADRATURE_MODE == QUADRATURE_SAMPLED)
+   TIMSK2 &= ~bit(OCIE2A);
+   TCCR2B  = 0;
+#else
+   PCMSK2 &= ~(bit(ENCODER_A_BIT) | bit(ENCODER_B_BIT));
+   if (0 == PCMSK2) {
+      PCICR &= ~bit(PCIE2);
+   }
+#endif
+}
+
+
+#if (QUADRATURE_MODE == QUADRATURE_SAMPLED)
+
+/* Timer sampled encoder interrupt - both channels are sampled at a fixed
+ *    QUADRATURE_SAMPLE_HZ whatever the knob is doing, so the ISR load is
+ *    constant: ~75 cycles for a sample with no motion, ~111 with motion,
+ *    or about 8% of the CPU at 16kHz. Contact bounce that settles between
+ *    two samples is never seen at all, and bounce that straddles a sample
+ *    decodes as a +1/-1 pair that cancels out.
+ *
+ * The table recovers one missed transition, so the knob is tracked 
+ *    exactly up to QUADRATURE_SAMPLE_HZ transitions/sec (~160 revs/sec at
+ *    x4 and 16kHz). An interrupt blackout just delays a sample - the next
+ *    sample sees the current pin state, so the same one missed transition
+ *    limit applies across the blackout.
+ *
+ * See HostTools/quadcompare for a load and missed count comparison of
+ *    the two modes under synthetic bounce bursts.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+   PIN_TRACE_ISR(PIN_TRACE_ENCODER);
+
+   decode();
+}
+
+#else
+
+/* Fast path encoder interrupt - every edge of either channel lands here.
+ *
+ * The table is int8_t, and there is no callback indirection, so the 
+ *    compiler only has to save the handful of registers used here 
+ *    instead of every call-clobbered register.
+ *
+ * Cycle budget (ATmega328 @ 16MHz, avr-gcc -Os) of the default build,
+ *    with LATENCY_STATS, TRACE_RECORD and PIN_TRACE all 0:
+ *    interrupt response + vector jmp        7
+ *    prologue (SREG, r0, r1, 6x regs)      ~19
+ *    PIND read, shift, mask, table load    ~12
+ *    32-bit add and store of the position  ~20
+ *    Timebase stamp of the edge            ~22
+ *    sequence increment, save oldState      ~8
+ *    epilogue + reti                       ~25
+ *    -------------------------------------------
+ *    worst case                           ~115 cycles (~7.2us)
+ *
+ *    The old digitalRead() x2 + callback[] icall path was ~300 cycles.
+ *
+ *    LATENCY_STATS 1 puts a call to micros() in every edge - the
+ *    prologue and epilogue then save every call-clobbered register
+ *    (~48 more cycles), and the first edge of a burst runs micros()
+ *    itself (~55), for a worst case of ~220 cycles (~14us).
+ *
+ * Maximum sustainable edge rate: the ISR alone could keep up with about
+ *    140k edges/sec, but the real limit is interrupt blackouts. Edges
+ *    that land inside an interrupts-off window are decoded as one
+ *    interrupt when it ends, and the +/-2 entries of the table only
+ *    recover one missed transition - with its direction guessed - so
+ *    the knob is only tracked exactly with one edge per window. The
+ *    longest window is strip.show() (8 pixels x 24 bits x 1.25us =
+ *    240us), which limits the knob to about 4k edges/sec, or ~40
+ *    revolutions/sec at x4 decoding - still beyond what a robot can
+ *    turn it. HostTools/quadstress bears this out: with the pixel load
+ *    and 4000 clean transitions a run, nothing is lost at 2000
+ *    transitions/sec, but 688 counts are at 5000 and 2096 at 8000.
+ *    At x2 or x1 only channel A interrupts, which halves the interrupt
+ *    rate but not this limit - B still changes between two A edges, and
+ *    an A edge takes its direction from B, so it is still one physical
+ *    edge of either channel per window, ~40 revolutions/sec at any
+ *    resolution. quadstress built at x2 and x1 loses counts from the
+ *    same 5000 transitions/sec.
+ */
+ISR(PCINT2_vect)
+{
+   PIN_TRACE_ISR(PIN_TRACE_ENCODER);
+
+   decode();
+}
+
+#endif
@@ -0,0 +1,87 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Quadrature.h
+ *
+ * This is the header file for the stage #3 quadrature encoder
+ * decoder.
+ *
+ * Both encoder channels (D3 and D4) are on PORTD, so a single
+ * pin change vector (PCINT2) services every edge of both channels
+ * with one read of PIND. The vector is owned directly by this code
+ * rather than going through the SimplePinChange callback table.
+ *
+ * Alternatively (QUADRATURE_MODE in ArenaControl.h) both channels 
+ * are sampled from a fixed rate Timer2 compare interrupt instead.
+ *
+ * Every count is stamped with the Timebase time of the edge (or
+ * sample) that made it, for the knob speed.
+ *
+ * The count and the pin state it was decoded from are kept in RAM
+ * the C runtime leaves alone (ARENA_NOINIT), so a match resumed
+ * after a watchdog reset carries on from the last edge the interrupt
+ * counted rather than from the older count in the checkpoint - a
+ * reset while the knob turns would otherwise leave the count off the
+ * whole turn grid for the rest of the match.
+ *
+ ********************************************************************/
+
+#ifndef Quadrature_h
+#define Quadrature_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Latency.h"
+
+#define ENCODER_A_PIN     3     // PD3 / PCINT19
+#define ENCODER_B_PIN     4     // PD4 / PCINT20
+
+class QuadratureClass
+{
+   public:
+      static void start(void);
+      static boolean resume(long checkpointed);
+      static void stop(void);
+
+      /* Return a consistent snapshot of the encoder position. The ISR 
+       *    bumps 'sequence' after every update, so if it changed while 
+       *    the 4 bytes were being copied the copy may be torn and is 
+       *    simply retried. Interrupts are never disabled, and the common
+       *    case is one extra byte load and compare.
+       */
+      static inline long read(void) {
+         uint8_t before;
+         long    snapshot;
+
+         do {
+            before   = sequence;
+            snapshot = value;
+         } while (before != sequence);
+
+         return snapshot;
+      }
+
+      /* The same, with the Timebase time of the last count */
+      static inline long read(uint32_t &edgeTime) {
+         uint8_t before;
+         long    snapshot;
+
+         do {
+            before   = sequence;
+            snapshot = value;
+            edgeTime = edge;
+         } while (before != sequence);
+
+         return snapshot;
+      }
+
+      static volatile long     value;     // updated by the encoder interrupt
+      static volatile uint32_t edge;      // Timebase ticks of the last update
+      static volatile uint8_t  sequence;  // incremented after each update
+};
+
+extern QuadratureClass Quadrature;
+
+/* Encoder edge to quadrature LED update, started from the encoder ISR */
+extern LatencyPath encoderLatency;
+
+#endif
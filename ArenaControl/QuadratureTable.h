@@ -0,0 +1,154 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - QuadratureTable.h
+ *
+ * This is the header file for the quadrature state change table,
+ * shared by the encoder interrupt (edge triggered or timer sampled)
+ * and the host-side decoder models. It has no Arduino dependencies.
+ *
+ * The table is generated at compile time for the decoding resolution
+ * chosen by QUADRATURE_RESOLUTION in ArenaControl.h - x4 counts every
+ * edge of both channels, x2 counts both edges of channel A, and x1 
+ * counts one edge of channel A per cycle. The encoder has 24 cycles 
+ * per revolution, so there are 96 counts per revolution at x4.
+ *
+ ********************************************************************/
+
+#ifndef QuadratureTable_h
+#define QuadratureTable_h
+
+#include <stdint.h>
+
+#include "ArenaControl.h"
+
+#define QUADRATURE_CYCLES   24      // quadrature cycles (clicks) per revolution
+
+/* This quadrature encoder interrupt handler is based heavily
+ *   on an the implementation in the Encoder library at:
+ *
+ *     https://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * First an overview of the two lines in a quadrature encoder:
+ *               _____       _____
+ *   Pin1:  ____|     |_____|     |____
+ *            _____       _____       _  
+ *   Pin2:  _|     |_____|     |_____|
+ *
+ *        <--- negative     positive --->
+ *
+ * By examining the current two pins and the two previous
+ *    pins, we can determine the position and amount of
+ *    motion (assume we can respond fast enough to only 
+ *    lose at most 1 transition).
+ *
+ *   new    new    old    old
+ *   pin2   pin1   pin2   pin1   Result
+ *   ----   ----   ----   ----   ------
+ *    0      0      0      0     no movement
+ *    0      0      0      1     +1
+ *    0      0      1      0     -1
+ *    0      0      1      1     +2
+ *    0      1      0      0     -1
+ *    0      1      0      1     no movement
+ *    0      1      1      0     -2
+ *    0      1      1      1     +1
+ *    1      0      0      0     +1
+ *    1      0      0      1     -2
+ *    1      0      1      0     no movement
+ *    1      0      1      1     -1
+ *    1      1      0      0     +2
+ *    1      1      0      1     -1
+ *    1      1      1      0     +1
+ *    1      1      1      1     no movement
+ *   ----   ----   ----   ----   ------
+ */
+
+/* x4 state change based on table above, as a function so the tables for
+ *    every resolution can be built from it at compile time
+ */
+constexpr int8_t quadratureX4(uint8_t s)
+{
+   return ((s ==  1) || (s ==  7) || (s ==  8) || (s == 14)) ? +1 :
+          ((s ==  2) || (s ==  4) || (s == 11) || (s == 13)) ? -1 :
+          ((s ==  3) || (s == 12))                           ? +2 :
+          ((s ==  6) || (s ==  9))                           ? -2 : 0;
+}
+
+/* Did channel A (pin1) change? - old A in bit 0, new A in bit 2 */
+constexpr bool quadratureAChanged(uint8_t s)
+{
+   return ((s >> 2) ^ s) & 1;
+}
+
+/* State change for a given resolution:
+ *
+ *   x4: every transition of either channel counts (the table above)
+ *   x2: only transitions of channel A count, one each, in the direction
+ *       the x4 table gives (B may have changed too if A interrupts alone)
+ *   x1: only channel A transitions while B is high count - rising A is
+ *       +1, and falling A (the same edge crossed backwards) is -1. Both
+ *       edges of A must still be seen, or dithering back and forth 
+ *       across the counted edge would count it over and over.
+ */
+constexpr int8_t quadratureChange(uint8_t resolution, uint8_t s)
+{
+   return (4 == resolution) ? quadratureX4(s) :
+          (2 == resolution) ? (quadratureAChanged(s) ? ((quadratureX4(s) > 0) ? +1 : -1) : 0) :
+                              ((quadratureAChanged(s) && ((s >> 3) & 1)) ? (((s >> 2) & 1) ? +1 : -1) : 0);
+}
+
+template<uint8_t RESOLUTION>
+struct QuadratureTable
+{
+   /* int8_t so the ISR does a single byte load and a sign extend */
+   static const int8_t stateChange[16];
+
+   /* Counts per revolution, and the +/- counts around a whole turn that
+    *    are 'center' (1.5 clicks, rounded down to a whole count at x1).
+    *    The single count at x1 is one click, and a knob at rest sits on
+    *    a detent, one per click - so at rest the x1 window takes the
+    *    same three detents (the whole turn and one click either side) as
+    *    the +/-6 counts at x4. Only a knob in motion sees the difference,
+    *    entering and leaving the center half a click later.
+    */
+   static const int revolution = QUADRATURE_CYCLES * RESOLUTION;
+   static const int center     = (6 * RESOLUTION) / 4;
+
+   /* Only x4 needs interrupts on channel B - x2 and x1 are driven by
+    *    both edges of channel A alone, halving the interrupt rate
+    */
+   static const bool channelB  = (4 == RESOLUTION);
+};
+
+template<uint8_t RESOLUTION>
+const int8_t QuadratureTable<RESOLUTION>::stateChange[16] = 
+{
+   quadratureChange(RESOLUTION,  0), quadratureChange(RESOLUTION,  1),
+   quadratureChange(RESOLUTION,  2), quadratureChange(RESOLUTION,  3),
+   quadratureChange(RESOLUTION,  4), quadratureChange(RESOLUTION,  5),
+   quadratureChange(RESOLUTION,  6), quadratureChange(RESOLUTION,  7),
+   quadratureChange(RESOLUTION,  8), quadratureChange(RESOLUTION,  9),
+   quadratureChange(RESOLUTION, 10), quadratureChange(RESOLUTION, 11),
+   quadratureChange(RESOLUTION, 12), quadratureChange(RESOLUTION, 13),
+   quadratureChange(RESOLUTION, 14), quadratureChange(RESOLUTION, 15)
+};
+
+/* The decoder as configured for the arena */
+typedef QuadratureTable<QUADRATURE_RESOLUTION> EncoderTable;
+
+/* Fold the new pin state (A in bit 0, B in bit 1) into the 4-bit state
+ *    and return the position change for the transition
+ */
+template<uint8_t RESOLUTION>
+static inline int8_t quadratureStep(uint8_t &state, uint8_t pins)
+{
+   state = (state >> 2) | (pins << 2);
+   return QuadratureTable<RESOLUTION>::stateChange[state];
+}
+
+static inline int8_t quadratureStep(uint8_t &state, uint8_t pins)
+{
+   return quadratureStep<QUADRATURE_RESOLUTION>(state, pins);
+}
+
+#endif
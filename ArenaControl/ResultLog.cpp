@@ -0,0 +1,199 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - ResultLog.cpp
+ *
+ * This is the code file for the match result log.
+ *
+ ********************************************************************/
+
+#include <avr/eeprom.h>
+
+#include "Arduino.h"
+#include "ResultLog.h"
+
+static const uint8_t header[4] = { 'A', 'R', RESULT_VERSION, sizeof(ResultRecord) };
+
+static uint16_t crc16(const uint8_t *data, uint8_t length);
+static uint8_t *recordAddress(uint8_t slot);
+
+
+ResultLog::ResultLog(Stage1 &stage1, Stage2 &stage2, Stage3 &stage3) :
+   stage1(stage1), stage2(stage2), stage3(stage3)
+{
+   empty = true;
+   latest = 0;
+   sequence = 0;
+}
+
+
+/* Find the latest record, from setup(). The header is checked first,
+ *    and a log of another version (or an EEPROM never used by the arena)
+ *    is cleared.
+ */
+void ResultLog::begin(void)
+{
+   uint8_t      found[sizeof(header)];
+   uint8_t      index[RESULT_SLOTS];
+   ResultRecord record;
+
+   eeprom_read_block(found, (const void *) RESULT_HEADER, sizeof(found));
+   if (0 != memcmp(found, header, sizeof(header))) {
+      memset(index, 0xFF, sizeof(index));
+      eeprom_update_block(index, (void *) RESULT_INDEX, sizeof(index));
+      eeprom_update_block(header, (void *) RESULT_HEADER, sizeof(header));
+   }
+
+   /* The latest record is before the first break in the sequence, or
+    *    before that if its CRC is bad
+    */
+   eeprom_read_block(index, (const void *) RESULT_INDEX, sizeof(index));
+   uint8_t slot = 0;
+   while ((slot < RESULT_SLOTS - 1) && (index[slot + 1] == (uint8_t) (index[slot] + 1))) {
+      slot++;
+   }
+
+   empty = true;
+   for (uint8_t tries=0; tries < RESULT_SLOTS; tries++) {
+      if (read(slot, record) && ((uint8_t) record.sequence == index[slot])) {
+         empty = false;
+         latest = slot;
+         sequence = record.sequence;
+         break;
+      }
+      slot = (slot + RESULT_SLOTS - 1) % RESULT_SLOTS;
+   }
+
+   Serial.print(F("RESULT LOG: "));
+   if (empty) {
+      Serial.println(F("empty"));
+   } else {
+      Serial.print(F("last match #"));
+      Serial.print(record.sequence);
+      Serial.print(F(" score "));
+      Serial.println(record.score);
+   }
+}
+
+
+/* Save the match just over. Called once the results have been reported,
+ *    as each byte written takes 3.4ms.
+ */
+void ResultLog::save(int seed, uint32_t timestamp, int score)
+{
+   ResultRecord record;
+
+   memset(&record, 0, sizeof(record));
+   record.sequence   = empty ? 0 : sequence + 1;
+   record.seed       = seed;
+   record.score      = score;
+   record.stage2     = stage2.score();
+   record.stage3     = stage3.score();
+   record.relayIndex = stage1.relayIndex;
+   record.saberIndex = stage2.pattern();
+   record.runTime    = (timestamp < COUNTDOWN_TIME * MSECS) ? 0 :
+                       (timestamp - COUNTDOWN_TIME * MSECS) / 100;
+   memcpy(record.hits, stage2.hits(), strnlen(stage2.hits(), sizeof(record.hits)));
+   if ('-' != stage3.digits()[0]) {
+      memcpy(record.digits, stage3.digits(), strnlen(stage3.digits(), sizeof(record.digits)));
+   }
+   record.crc = crc16((const uint8_t *) &record, sizeof(record) - sizeof(record.crc));
+
+   /* The record, then its index byte - the record only counts once the
+    *    index byte is written
+    */
+   uint8_t slot = record.sequence % RESULT_SLOTS;
+   eeprom_update_block(&record, recordAddress(slot), sizeof(record));
+   eeprom_update_byte((uint8_t *) RESULT_INDEX + slot, (uint8_t) record.sequence);
+
+   empty = false;
+   latest = slot;
+   sequence = record.sequence;
+}
+
+
+/* Answer a dump request from the serial port, if there is one */
+void ResultLog::poll(void)
+{
+   while (Serial.available()) {
+      int c = Serial.read();
+      if (('D' == c) || ('d' == c)) {
+         dump();
+      }
+   }
+}
+
+
+/* Print every record, oldest first, one line each:
+ *    #<sequence> <score> = <stage 2> + <stage 3> seed <n> relay <n>
+ *       saber <n> time <s> [<hits>] <digits>
+ */
+void ResultLog::dump(void)
+{
+   ResultRecord record;
+   char         text[sizeof(record.digits) + 1];
+
+   Serial.print(F("------ RESULT LOG ------\n"));
+   for (uint8_t n=1; !empty && (n <= RESULT_SLOTS); n++) {
+      uint8_t slot = (latest + n) % RESULT_SLOTS;
+
+      if (!read(slot, record) || (record.sequence % RESULT_SLOTS != slot) ||
+          ((uint16_t) (sequence - record.sequence) >= RESULT_SLOTS)) {
+         continue;
+      }
+      Serial.print('#');
+      Serial.print(record.sequence);
+      Serial.print(' ');
+      Serial.print(record.score);
+      Serial.print(F(" = "));
+      Serial.print(record.stage2);
+      Serial.print(F(" + "));
+      Serial.print(record.stage3);
+      Serial.print(F(" seed "));
+      Serial.print(record.seed);
+      Serial.print(F(" relay "));
+      Serial.print(record.relayIndex);
+      Serial.print(F(" saber "));
+      Serial.print(record.saberIndex);
+      Serial.print(F(" time "));
+      Serial.print(record.runTime / 10);
+      Serial.print('.');
+      Serial.print(record.runTime % 10);
+      Serial.print(F(" ["));
+      Serial.write((const uint8_t *) record.hits, strnlen(record.hits, sizeof(record.hits)));
+      Serial.print(F("] "));
+      memcpy(text, record.digits, sizeof(record.digits));
+      text[sizeof(record.digits)] = '\0';
+      Serial.print(text[0] ? text : "--none--");
+      Serial.print('\n');
+   }
+   Serial.print(F("------ END ------\n"));
+}
+
+
+/* Read a slot - false if its CRC is bad */
+boolean ResultLog::read(uint8_t slot, ResultRecord &record)
+{
+   eeprom_read_block(&record, recordAddress(slot), sizeof(record));
+   return record.crc == crc16((const uint8_t *) &record, sizeof(record) - sizeof(record.crc));
+}
+
+
+static uint8_t *recordAddress(uint8_t slot)
+{
+   return (uint8_t *) RESULT_RECORDS + slot * sizeof(ResultRecord);
+}
+
+
+/* CRC-16-CCITT, bit at a time - it only runs at boot and after a match */
+static uint16_t crc16(const uint8_t *data, uint8_t length)
+{
+   uint16_t crc = 0xFFFF;
+
+   while (length--) {
+      crc ^= (uint16_t) *data++ << 8;
+      for (uint8_t b=0; b < 8; b++) {
+         crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+      }
+   }
+   return crc;
+}
@@ -0,0 +1,87 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - ResultLog.h
+ *
+ * This is the header file for the match result log.
+ *
+ * The results of the last RESULT_SLOTS matches are kept in the
+ * EEPROM, so a match that ends with no serial cable attached can
+ * still be scored after the arena is reset. Each match is saved
+ * once it is over (never during the match), as a compact record
+ * with its own CRC, to the slot after the last one written. The
+ * writes go round all the slots in turn, which spreads the wear,
+ * and only the bytes that change are written.
+ *
+ * EEPROM layout:
+ *    0    header - magic, version and record size, a mismatch
+ *         clears the log
+ *    32   index - the low byte of the sequence number of the
+ *         record in each slot, written after the record
+ *    64   RESULT_SLOTS records
+ *
+ * The index is all that is read to find the latest record at boot.
+ * Sequence numbers go up by one from slot to slot, so the latest
+ * record is the one before the first break in the run, and only
+ * its CRC has to be checked. A record left half written by a power
+ * loss never had its index byte written, so the record before it
+ * is found instead.
+ *
+ * Sending 'D' on the serial port while the arena waits for START,
+ * or after a match, dumps every record, oldest first.
+ *
+ ********************************************************************/
+
+#ifndef ResultLog_h
+#define ResultLog_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Stage1.h"
+#include "Stage2.h"
+#include "Stage3.h"
+
+#define RESULT_VERSION   1
+#define RESULT_SLOTS     32
+#define RESULT_HEADER    0
+#define RESULT_INDEX     32
+#define RESULT_RECORDS   64
+
+/* One match - 30 bytes */
+struct ResultRecord {
+   uint16_t sequence;           // counts matches, from 0
+   int16_t  seed;               // RANDOM SEED
+   int16_t  score;              // FINAL SCORE
+   int16_t  stage2;
+   int16_t  stage3;
+   uint8_t  relayIndex;
+   uint8_t  saberIndex;
+   uint16_t runTime;            // tenths of a second
+   char     hits[9];            // HIT REPORT
+   char     digits[5];          // Digits entered, NUL padded
+   uint16_t crc;                // of everything above
+};
+
+class ResultLog
+{
+   public:
+      ResultLog(Stage1 &stage1, Stage2 &stage2, Stage3 &stage3);
+
+      void begin(void);
+      void save(int seed, uint32_t timestamp, int score);
+      ARENA_PROFILED void poll(void);
+      void dump(void);
+
+   private:
+      boolean read(uint8_t slot, ResultRecord &record);
+
+      Stage1  &stage1;
+      Stage2  &stage2;
+      Stage3  &stage3;
+      boolean  empty;
+      uint8_t  latest;          // slot of the latest record, if not empty
+      uint16_t sequence;        // of the latest record
+};
+
+extern ResultLog Results;
+
+#endif
@@ -131,6 +131,34 @@ void Sainsmart_I2CLCD::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
   
 }
 
+// Pick the display up again after a reset of the Arduino alone (the
+// watchdog, say). The LCD kept its power and settings, so there is no
+// power-on wait and nothing is cleared - the same three 8 bit function
+// sets as begin() bring it back into step whichever nibble it was
+// waiting for, then it is set up as before.
+void Sainsmart_I2CLCD::resume(){
+	_displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+	if (_rows > 1) {
+		_displayfunction |= LCD_2LINE;
+	}
+	_numlines = _rows;
+	_backlightval = LCD_BACKLIGHT;
+
+	write4bits(0x03 << 4);
+	delayMicroseconds(4500);
+	write4bits(0x03 << 4);
+	delayMicroseconds(4500);
+	write4bits(0x03 << 4);
+	delayMicroseconds(150);
+	write4bits(0x02 << 4);
+
+	command(LCD_FUNCTIONSET | _displayfunction);
+	_displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+	display();
+	_displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+	command(LCD_ENTRYMODESET | _displaymode);
+}
+
 /********** high level commands, for the user! */
 void Sainsmart_I2CLCD::clear(){
 	command(LCD_CLEARDISPLAY);// clear display, set cursor position to zero
@@ -85,6 +85,7 @@ public:
 #endif
   void command(uint8_t);
   void init();
+  void resume();
 
 ////compatibility API function aliases
 void blink_on();						// alias for blink()
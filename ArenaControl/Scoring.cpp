@@ -0,0 +1,58 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Scoring.cpp
+ *
+ * This is the code file for the stage #2 and stage #3 scoring rules. 
+ *
+ ********************************************************************/
+
+#include "Scoring.h"
+
+#define BAD_HIT_PENALTY   50
+
+static const int goodHitPoints[]   = { 0, 40, 105, 150, 210, 290 };
+#define MAX_GOOD_HITS     (sizeof(goodHitPoints) / sizeof(goodHitPoints[0]) - 1)
+static const int goodDigitPoints[] = { 0, 45, 95, 155, 230, 325 };
+static const uint16_t powersOfTen[SCORE_DIGITS] = { 10000, 1000, 100, 10, 1 };
+
+
+int stage2Score(const char *hitReport, uint8_t length)
+{
+   int badHits = 0;
+   int goodHits = 0;
+   int score;
+
+   for (uint8_t loop=0; (loop < length) && hitReport[loop]; loop++) {
+      if ('-' == hitReport[loop]) {
+         badHits++;
+      } else if ('+' == hitReport[loop]) {
+         goodHits++;
+      }
+   }
+
+   /* A duel has fewer ON windows, but a damaged log can hold more '+' */
+   if (goodHits > (int) MAX_GOOD_HITS) {
+      goodHits = MAX_GOOD_HITS;
+   }
+
+   score = goodHitPoints[goodHits] - (badHits * BAD_HIT_PENALTY);
+   if (0 > score) {
+      score = 0;
+   }
+   return score;
+}
+
+
+int stage3Score(const char *digits, uint8_t length, uint16_t turnPattern)
+{
+   int numCorrect = 0;
+
+   for (uint8_t loop=0; (loop < length) && (loop < SCORE_DIGITS) && digits[loop]; loop++) {
+      int expected = (turnPattern / powersOfTen[loop]) % 10;
+      int found    = digits[loop] - '0';
+      if (expected == found) {
+         numCorrect++;
+      }
+   }
+   return goodDigitPoints[numCorrect];
+}
@@ -0,0 +1,36 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Scoring.h
+ *
+ * This is the header file for the stage #2 and stage #3 scoring 
+ * rules. 
+ *
+ * The rules have no Arduino dependencies, so the sketch scores a
+ * match with the same code the host tools use to re-score the
+ * archived serial logs of past matches when a rule changes.
+ *
+ * Both take the text the stage reports print (the hit report and
+ * the digits entered) as a pointer and a length, so the host can
+ * score straight from a log without copying it.
+ *
+ ********************************************************************/
+
+#ifndef Scoring_h
+#define Scoring_h
+
+#include <stdint.h>
+
+#define SCORE_DIGITS      5     // digits of the stage 3 turn pattern
+
+/* Stage 2 - points for the number of hits with the field on ('+' in the
+ *    hit report, the points for 5 at most), less a penalty for each hit
+ *    with it off ('-'), and never below zero
+ */
+int stage2Score(const char *hitReport, uint8_t length);
+
+/* Stage 3 - points for the number of digits entered (ASCII, the last 
+ *    SCORE_DIGITS) that match the turn pattern, digit by digit
+ */
+int stage3Score(const char *digits, uint8_t length, uint16_t turnPattern);
+
+#endif
@@ -10,6 +10,8 @@
  * elimination introduced bugs that were fixed by Rod Radford March 21, 2017.
  */
 
+#include <Arduino.h>
+#include "ArenaControl.h"      // SIMPLEPINCHANGE_EXTERNAL_PORTS
 #include "SimplePinChange.h"
 
 // Callback for port change or NULL if none defined
@@ -55,6 +57,11 @@ bool SimplePinChangeClass::attach(uint8_t pin, void (*handler)()) {
 
   uint8_t pcicr_bit = digitalPinToPCICRbit(pin);
 
+  if (SIMPLEPINCHANGE_EXTERNAL_PORTS & bit(pcicr_bit)) {
+    // Port vector is owned by other code
+    return false;
+  }
+
   // Remember if there was any subscription already
 
   bool subscription = callback[pcicr_bit];
@@ -130,6 +137,7 @@ ISR(PCINT1_vect) {
 }
 
 // Vector for pin 0-7 change interrupt
+#if !(SIMPLEPINCHANGE_EXTERNAL_PORTS & (1 << 2))
 ISR(PCINT2_vect) {
   if (callback[2]) {
     callback[2]();
@@ -138,3 +146,4 @@ ISR(PCINT2_vect) {
     spurious_interrupt |= 4;
   }
 }
+#endif
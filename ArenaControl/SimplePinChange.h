@@ -18,6 +18,14 @@
 
 #define NUM_PORTS 3
 
+// Mask of ports whose vector is defined outside this library (bit 0 for
+// PCINT0, 1 for PCINT1, 2 for PCINT2). Pins on these ports cannot be
+// attached. Define it before including this header to claim a port; the
+// arena sets it in ArenaControl.h.
+#ifndef SIMPLEPINCHANGE_EXTERNAL_PORTS
+#define SIMPLEPINCHANGE_EXTERNAL_PORTS 0
+#endif
+
 typedef void (*voidFuncPtr)();
 
 class SimplePinChangeClass {
@@ -32,6 +40,7 @@ class SimplePinChangeClass {
     //  Pins 14-21 (A0-A7) are in the port for PCINT1, but NOTE that pins 20 
     //  and 21 (A6, A7) cannot be used for digital I/O.
     //  Pins 0-7 are in the port for PCINT2.
+    // Pins on a port listed in SIMPLEPINCHANGE_EXTERNAL_PORTS return false.
     static bool attach(uint8_t pin, void (*callback)());
 
     // Remove the association of a change of the given pin with an interrupt.
@@ -24,17 +24,17 @@
 #include <avr/pgmspace.h>
 
 #include "Stage1.h"
+#include "PinTrace.h"
 #include "relayTable.h"
 
-#include "Controller.h"
-extern Controller controller;
+#include "Trace.h"
 
 #define I2C_ADDR_RELAY   0x20
 
 void setRelays(uint16_t relayPattern);
 
 
-Stage1::Stage1() 
+Stage1::Stage1(Controller &controller) : controller(controller)
 {
 }
 
@@ -51,6 +51,18 @@ void Stage1::start()
    relayIndex   = random(RELAY_TABLE_LENGTH);
    relayPattern = pgm_read_word_near((relayTable[relayIndex]) + 0);
    turnPattern  = pgm_read_word_near((relayTable[relayIndex]) + 1);
+   Trace.event(TRACE_RELAY, relayIndex, turnPattern);
+}
+
+
+/* Carry on with the relay table entry of a checkpoint, instead of
+ *    choosing one - the relays are set again at the first step
+ */
+void Stage1::resume(uint16_t index)
+{
+   relayIndex   = index;
+   relayPattern = pgm_read_word_near((relayTable[relayIndex]) + 0);
+   turnPattern  = pgm_read_word_near((relayTable[relayIndex]) + 1);
 }
 
 
@@ -65,6 +77,8 @@ void Stage1::stop(uint32_t timestamp)
 /* Step - cooperative multi-tasker between the stages */
 void Stage1::step(uint32_t timestamp) 
 {
+   PIN_TRACE_STEP(PIN_TRACE_STAGE1);
+
    static int firstTime = true;
    
    /* Set the relays once the contest starts - nothing to do otherwise */
@@ -127,6 +141,18 @@ int Stage1::score(void)
 }
 
 
+/* The relays are set by the first step, so never anything to do */
+boolean Stage1::idle(uint32_t timestamp)
+{
+  return true;
+}
+
+uint32_t Stage1::deadline(uint32_t timestamp)
+{
+  return MATCH_RUNTIME;
+}
+
+
 /* Set the 16 relays to the state in the 16-bit relay parameter. The relays
  *    are attached to the Arduino via an I2C 16-bit port expander.
  * This code can still run without the I2C port expander attached - the
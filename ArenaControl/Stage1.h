@@ -23,21 +23,28 @@
 
 #include "Arduino.h"
 #include "ArenaControl.h"
+#include "Controller.h"
 
 class Stage1 
 {
    public:
-      Stage1();
+      Stage1(Controller &controller);
 
       void start(void);
       void stop(uint32_t timestamp);
-      void step(uint32_t timestamp);
+      ARENA_PROFILED void step(uint32_t timestamp);
       void report(void);
       int  score(void);
+      boolean idle(uint32_t timestamp);
+      uint32_t deadline(uint32_t timestamp);
+      void resume(uint16_t index);
                  
       uint16_t relayIndex;
       uint16_t relayPattern;
       uint16_t turnPattern;
+
+   private:
+      Controller &controller;
 };
 
 #endif
@@ -12,9 +12,12 @@
 
 #include "Arduino.h"
 #include "Stage2.h"
-
-#include "Controller.h"
-extern Controller controller;
+#include "PinTrace.h"
+#include "Latency.h"
+#include "Trace.h"
+#include "Scoring.h"
+#include "Timebase.h"
+#include "MatchClock.h"
 
 /*
  * Defines used by this stage
@@ -54,16 +57,11 @@ enum states {
  */
 static uint32_t white, black, red, lt_red, green, lt_green, blue, amber;
 static volatile uint16_t hit = 0;
-int ignore_hits = true;
-enum states curState  = INITIAL;
-enum states nextState = COUNTDOWN_1;
-uint32_t nextStateTimestamp = 0;
-uint32_t flashOffTimestamp  = 0;
-uint8_t  *patternPtr = NULL;
-uint8_t  patternIndex = 0;
-uint32_t hitTimeout = 0;
-int      enableField = false;
-char     hitReport[10], *hitReportPtr = hitReport;
+static volatile uint32_t hitTicks;      // Timebase ticks of the first edge of 'hit'
+static Stage2State saber = {
+   INITIAL, COUNTDOWN_1, 0, 0, 0, 0, 0, 0, 0, true, false, false, 0, ""
+};
+LatencyPath hitLatency;                 // vibration edge to red/blue saber flash
 
 Adafruit_NeoPixel strip = Adafruit_NeoPixel(NEOPIXEL_LED_COUNT, NEOPIXEL_PIN, NEO_GRB+NEO_KHZ800);
 
@@ -73,6 +71,8 @@ Adafruit_NeoPixel strip = Adafruit_NeoPixel(NEOPIXEL_LED_COUNT, NEOPIXEL_PIN, NE
  */
 static void vibrate();
 static int hit_detected(void);
+static int hit_in_window(uint32_t close);
+static uint32_t window_close(void);
 static void singleColor(uint32_t c);
 static void activateField(boolean state);
 
@@ -101,7 +101,7 @@ uint8_t fightingPatterns[10][5] = {
 };
 
 
-Stage2::Stage2() 
+Stage2::Stage2(Controller &controller) : controller(controller)
 {
 }
 
@@ -133,9 +133,9 @@ void Stage2::start()
    strip.show();
    
    /* Initialize the hit report log to empty */
-   memset(hitReport, '.', sizeof(hitReport));
-   hitReport[sizeof(hitReport)-1] = '\0';
-   hitReportPtr = hitReport;
+   memset(saber.hitReport, '.', sizeof(saber.hitReport));
+   saber.hitReport[sizeof(saber.hitReport)-1] = '\0';
+   saber.hitSlot = 0;
 }
 
 
@@ -150,34 +150,40 @@ void Stage2::stop(uint32_t timestamp)
 
 void Stage2::step(uint32_t timestamp) 
 {
+   PIN_TRACE_STEP(PIN_TRACE_STAGE2);
+
+   uint32_t close;
+
    /* If the hit timer is on, then the lightsaber is either red or blue, so
     *    check if it is time to turn the lightsaber back off 
     */
-   if ((0 != hitTimeout) && (millis() > hitTimeout)) {
-      hitTimeout = 0;
+   if ((0 != saber.hitTimeout) && ((int32_t) (timestamp - saber.hitTimeout) > 0)) {
+      saber.hitTimeout = 0;
       singleColor(black);
    }
    
    /* If the next timestamp has not yet occurred, then not time to advance
     *    to the next state, so nothing more to do
     */
-   if ((INITIAL != curState) && (millis() < nextStateTimestamp)) {
+   if ((INITIAL != saber.curState) && ((int32_t) (timestamp - saber.nextStateTimestamp) < 0)) {
       return;
    }
    
    /* If we are switching state, then update next state variable and zero out
     *    the hit flag to avoid hits in the previous state being counted in the
-    *    next state
+    *    next state. The field windows are timed from here.
     */
-   if (curState != nextState) {
-     curState = nextState;
+   if (saber.curState != saber.nextState) {
+     saber.curState = saber.nextState;
+     saber.windowOpen = timestamp;
      hit = 0;
+     hitLatency.cancel();
    }
    
    /* State table - actions and next state based on the current state, timeout
     *    and vibration hit flag 
     */
-   switch (curState) {
+   switch (saber.curState) {
      
      /* We have three countdown states. The plan is that when the robot is ready,
       *    the team is warned they have 3 seconds to start the robot. The arena
@@ -186,6 +192,8 @@ void Stage2::step(uint32_t timestamp)
       * The first state is COUNTDOWN state 1 and occurs as soon as the board is
       *    powered on. When the lightsaber turns red, the arena judge counts '3'
       *    to the team indicating 3 seconds before the match begins.
+      * The countdown states change on the whole seconds of match time, the
+      *    same pass of loop() as the LCD countdown.
       * Next state: COUNTDOWN_2 after 1 second
       */
      case COUNTDOWN_1: 
@@ -194,8 +202,8 @@ void Stage2::step(uint32_t timestamp)
           strip.setPixelColor(6, green);
           strip.show();
 
-          nextState = COUNTDOWN_2;
-          nextStateTimestamp = millis() + ONE_SECOND;
+          saber.nextState = COUNTDOWN_2;
+          saber.nextStateTimestamp = ONE_SECOND;
           break;
 
       /* This is the continuation of the countdown. The top half of the lightsaber
@@ -209,8 +217,8 @@ void Stage2::step(uint32_t timestamp)
           strip.setPixelColor(3, green);
           strip.show();
           
-          nextState = COUNTDOWN_3;
-          nextStateTimestamp = millis() + ONE_SECOND;
+          saber.nextState = COUNTDOWN_3;
+          saber.nextStateTimestamp = 2 * ONE_SECOND;
           break;
 
       /* This is the next and final of the countdown states. The entire lightsaber
@@ -225,8 +233,8 @@ void Stage2::step(uint32_t timestamp)
           strip.setPixelColor(0, green);
           strip.show();
 
-          nextState = START;
-          nextStateTimestamp = millis() + ONE_SECOND;
+          saber.nextState = START;
+          saber.nextStateTimestamp = COUNTDOWN_TIME * ONE_SECOND;
           break;
 
       /* The entire lightsaber lights green to indicate the match has begun and
@@ -239,8 +247,8 @@ void Stage2::step(uint32_t timestamp)
        */
       case START:
           singleColor(green);
-          nextState = WAITING;
-          nextStateTimestamp = millis() + (5 * ONE_SECOND);
+          saber.nextState = WAITING;
+          saber.nextStateTimestamp = timestamp + (5 * ONE_SECOND);
           break;
           
       /* In this stage, we are waiting for the first hit of the 
@@ -250,20 +258,22 @@ void Stage2::step(uint32_t timestamp)
        */
       case WAITING:
           /* Activate the field and interrupt and wait for first hit */
-          ignore_hits = false;
+          saber.ignoreHits = false;
           activateField(true);
           
           /* the stage 2 lightsaber battle begins when the first hit is detected */
           if (hit_detected()) {
              singleColor(blue);
-             hitTimeout = millis();
-             nextState = FIELD_OFF_NEUTRAL;
-             nextStateTimestamp = millis();
+             hitLatency.output();
+             saber.hitTimeout = timestamp;
+             saber.nextState = FIELD_OFF_NEUTRAL;
+             saber.nextStateTimestamp = timestamp;
              
              /* Choose one of the 10 patterns using LSB of micros() function */
-             patternIndex = micros() % 10;
-             patternPtr = &(fightingPatterns[patternIndex][0]);
-             *hitReportPtr++ = '+';
+             saber.patternIndex = micros() % 10;
+             saber.patternStep = 0;
+             Trace.event(TRACE_SABER, saber.patternIndex, 0);
+             saber.hitReport[saber.hitSlot++] = '+';
              
           }
           break;
@@ -277,8 +287,8 @@ void Stage2::step(uint32_t timestamp)
        */
       case FIELD_OFF_NEUTRAL:
           activateField(false);
-          nextState = FIELD_OFF;
-          nextStateTimestamp = millis() + HALF_SECOND;
+          saber.nextState = FIELD_OFF;
+          saber.nextStateTimestamp = timestamp + HALF_SECOND;
           break;
          
       /* In this state, the field is off, but the vibration sensor is active
@@ -287,16 +297,18 @@ void Stage2::step(uint32_t timestamp)
        * Next state: FIELD_ON when the next field on cycle occurs
        */ 
       case FIELD_OFF:
-          if (hit_detected()) {
-             *hitReportPtr = '-';
+          close = window_close();
+          if (hit_in_window(close)) {
+             saber.hitReport[saber.hitSlot] = '-';
              singleColor(red);
-             hitTimeout = millis() + FLASH_TIMEOUT;
+             hitLatency.output();
+             saber.hitTimeout = timestamp + FLASH_TIMEOUT;
           }
-          if ((millis()-nextStateTimestamp) > (*patternPtr * ONE_SECOND)) {
-             nextState = FIELD_ON;
-             enableField = true;
-             nextStateTimestamp = millis();
-             hitReportPtr++;
+          if ((int32_t) (timestamp - close) >= 0) {
+             saber.nextState = FIELD_ON;
+             saber.enableField = true;
+             saber.nextStateTimestamp = timestamp;
+             saber.hitSlot++;
           }
           break;
         
@@ -307,21 +319,24 @@ void Stage2::step(uint32_t timestamp)
        * Next state: FIELD_OFF, unless this is the last on, then STOPPED
        */ 
       case FIELD_ON:
-          if (enableField) {
+          if (saber.enableField) {
              activateField(true);
-             enableField = false;
+             saber.enableField = false;
           }
-          if (hit_detected()) {
-             *hitReportPtr = '+';
+          close = window_close();
+          if (hit_in_window(close)) {
+             saber.hitReport[saber.hitSlot] = '+';
              singleColor(blue);
-             hitTimeout = millis() + FLASH_TIMEOUT;
+             hitLatency.output();
+             saber.hitTimeout = timestamp + FLASH_TIMEOUT;
              activateField(false);
           }
-          if ((millis()-nextStateTimestamp) > (2*ONE_SECOND)) {
-             patternPtr++;
-             nextState = (0 == *patternPtr) ? STOPPED : FIELD_OFF_NEUTRAL;
-             nextStateTimestamp = millis();
-             hitReportPtr++;
+          if ((int32_t) (timestamp - close) >= 0) {
+             saber.patternStep++;
+             saber.nextState = (0 == fightingPatterns[saber.patternIndex][saber.patternStep]) ?
+                               STOPPED : FIELD_OFF_NEUTRAL;
+             saber.nextStateTimestamp = timestamp;
+             saber.hitSlot++;
           }          
           break;
       
@@ -350,21 +365,25 @@ void Stage2::step(uint32_t timestamp)
 void Stage2::report(void) {
    Serial.print("------ Stage 2 report ------\n");
    Serial.print("SABER INDEX: ");
-   Serial.print(patternIndex);
+   Serial.print(saber.patternIndex);
    Serial.print("\nHIT REPORT : [");
-   Serial.print(hitReport);
-   Serial.print("]\nSTAGE SCORE: ");
+   Serial.print(saber.hitReport);
+   Serial.print("]\nLATE HITS  : ");
+   Serial.print(saber.lateHits);
+   Serial.print("\nSTAGE SCORE: ");
    Serial.print(score());
-   Serial.print("\n\n");   
+   Serial.print("\n");
+   hitLatency.report(F("hit->flash"));
+   Serial.print("\n");   
    
    if (controller.attached()) {
       controller.lcdp()->setCursor(0,2);
       controller.lcdp()->print("2: ");
       controller.lcdp()->print(String(score()));
       controller.lcdp()->print(" #");
-      controller.lcdp()->print(patternIndex);
+      controller.lcdp()->print(saber.patternIndex);
       controller.lcdp()->print(" ");
-      controller.lcdp()->print(String(hitReport));
+      controller.lcdp()->print(String(saber.hitReport));
    }
 }
 
@@ -375,33 +394,129 @@ void Stage2::report(void) {
  *    increases with each hit.
  */
 int Stage2::score(void) {
-  int goodHitPoints[] = { 0, 40, 105, 150, 210, 290 };
-  int badHits = 0;
-  int goodHits = 0;
-  int score = 0;
-  
-  for (char *cptr=hitReport; *cptr; cptr++) {
-      if ('-' == *cptr) {
-         badHits++;
-      } else if ('+' == *cptr) {
-         goodHits++;
-      }
+  return stage2Score(saber.hitReport, sizeof(saber.hitReport) - 1);
+}
+
+
+/* Nothing to do until an interrupt if the next state is not due yet.
+ *    Once it is, the state machine runs every pass, and has work if it
+ *    is switching state or there is a hit to count. The windows closing
+ *    and the flash ending are match time deadlines, seen
+ *    on the pass after the Timer0 interrupt that follows them.
+ */
+boolean Stage2::idle(uint32_t timestamp) {
+  if ((INITIAL != saber.curState) && ((int32_t) (timestamp - saber.nextStateTimestamp) < 0)) {
+     return true;
+  }
+  return (saber.curState == saber.nextState) && ((0 == hit) || saber.ignoreHits);
+}
+
+
+/* The next state change, field window close or end of a flash. A state
+ *    that waits for a hit (or for nothing) has no deadline of its own.
+ */
+uint32_t Stage2::deadline(uint32_t timestamp) {
+  uint32_t next = MATCH_RUNTIME;
+
+  if ((INITIAL != saber.curState) && ((int32_t) (timestamp - saber.nextStateTimestamp) < 0)) {
+     next = saber.nextStateTimestamp;
+  } else if ((FIELD_OFF == saber.curState) || (FIELD_ON == saber.curState)) {
+     next = window_close();
+  }
+  if ((0 != saber.hitTimeout) && ((int32_t) (saber.hitTimeout + 1 - next) < 0)) {
+     next = saber.hitTimeout + 1;
   }
+  return next;
+}
+
+
+/* The fighting pattern and hit report, for the result log */
+uint8_t Stage2::pattern(void) {
+  return saber.patternIndex;
+}
+
+const char *Stage2::hits(void) {
+  return saber.hitReport;
+}
+
 
-  score = goodHitPoints[goodHits] - (badHits * 50);
-  if (0 > score) {
-     score = 0;
+/* The name of the current state, for the query console */
+void Stage2::printState(Print &out) {
+  switch (saber.curState) {
+     case INITIAL:           out.print(F("INITIAL"));           break;
+     case COUNTDOWN_1:       out.print(F("COUNTDOWN_1"));       break;
+     case COUNTDOWN_2:       out.print(F("COUNTDOWN_2"));       break;
+     case COUNTDOWN_3:       out.print(F("COUNTDOWN_3"));       break;
+     case START:             out.print(F("START"));             break;
+     case WAITING:           out.print(F("WAITING"));           break;
+     case FIELD_OFF_NEUTRAL: out.print(F("FIELD_OFF_NEUTRAL")); break;
+     case FIELD_OFF:         out.print(F("FIELD_OFF"));         break;
+     case FIELD_ON:          out.print(F("FIELD_ON"));          break;
+     case STOPPED:           out.print(F("STOPPED"));           break;
+     default:                out.print(saber.curState);         break;
   }
+}
+
 
-  return score;
+/* The current state, the vibration edges the state machine has yet to
+ *    take, and the lightsaber color as RGB 3-3-2 - for the telemetry
+ */
+uint8_t Stage2::state(void) {
+  return saber.curState;
+}
+
+
+uint8_t Stage2::hitCount(void) {
+  uint16_t count;
+
+  noInterrupts();
+  count = hit;
+  interrupts();
+  return (count > 255) ? 255 : count;
+}
+
+
+uint8_t Stage2::color(void) {
+  uint32_t c = saber.saberColor;
+  return ((c >> 16) & 0xE0) | ((c >> 11) & 0x1C) | ((c >> 6) & 0x03);
+}
+
+
+/* Copy of the duel state for a checkpoint. A hit the state machine has
+ *    not seen yet is not part of it.
+ */
+void Stage2::checkpoint(Stage2State &state) {
+  state = saber;
+}
+
+
+/* Carry on from a checkpoint, after start(). The timestamps are match
+ *    time, which carries on from the checkpoint too, and the field and
+ *    lightsaber are put back as they were.
+ */
+void Stage2::resume(const Stage2State &state) {
+  saber = state;
+  hit = 0;
+  activateField(saber.fieldOn);
+  singleColor(saber.saberColor);
 }
 
 
 /* Interrupt routine that is triggered on every vibration hit. It just
- *    increments a global variable that is checked within the state machine.
+ *    increments a global variable that is checked within the state machine,
+ *    and stamps the first edge since the state machine last took the hits.
  */
 static void vibrate() {
+  PIN_TRACE_ISR(PIN_TRACE_VIBRATE);
+
+  if (0 == hit) {
+     hitTicks = Timebase.ticks();
+  }
   hit++;
+  hitLatency.input();
+#if TRACE_RECORD
+  Trace.input(TRACE_VIBRATE, (PIND >> VIBRATE_PIN) & 1, 0);
+#endif
 }
 
 
@@ -411,18 +526,57 @@ static void vibrate() {
 static int hit_detected(void) {
   int detected = 0;
   
-  if (hit && !ignore_hits) {
+  if (hit && !saber.ignoreHits) {
      detected = 1;
      hit = 0;
+  } else if (saber.ignoreHits) {
+     hitLatency.cancel();
   }
   
   return detected;
 }
 
 
+/* hit_detected() for a field window that closes at the match time
+ *    'close'. The state machine only sees the close on its next step, and
+ *    a hit whose first edge came after the close is not this window's even
+ *    if it arrived before then - it is dropped and counted as late. The
+ *    close is turned into a Timebase deadline by how far it is from the
+ *    pass's clock sample (see MatchClock.h), and the edge's ticks are
+ *    compared against that, so no part of a ms is rounded away. The
+ *    state machine only clears 'hit', so once it is seen hitTicks stays
+ *    put for this check.
+ */
+static int hit_in_window(uint32_t close) {
+  if (hit && !saber.ignoreHits) {
+     uint32_t closeTicks = Clock.ticks() - (int32_t) (Clock.now() - close) * TIMEBASE_TICKS_PER_MS;
+
+     if ((int32_t) (hitTicks - closeTicks) >= 0) {
+        hit = 0;
+        hitLatency.cancel();
+        saber.lateHits++;
+        return 0;
+     }
+  }
+  return hit_detected();
+}
+
+
+/* The match time the field window of the current state closes at - the
+ *    field is off for the pattern's time and on for 2 seconds
+ */
+static uint32_t window_close(void) {
+  if (FIELD_ON == saber.curState) {
+     return saber.windowOpen + (2 * ONE_SECOND);
+  }
+  return saber.windowOpen + fightingPatterns[saber.patternIndex][saber.patternStep] * ONE_SECOND;
+}
+
+
 /* Lights up the lightsaber all one color 
  */
 static void singleColor(uint32_t c) {
+  saber.saberColor = c;
   for (uint16_t i=0; i<strip.numPixels(); i++) {
     strip.setPixelColor(i, c);
   }
@@ -433,6 +587,7 @@ static void singleColor(uint32_t c) {
 /* Activates (or deactivates) the magnetic force depending on the state parameter
  */
 static void activateField(boolean state) {
+   saber.fieldOn = state;
    digitalWrite(FIELD_PIN, state ? HIGH : LOW); 
 }
 
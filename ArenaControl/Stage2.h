@@ -15,17 +15,53 @@
 
 #include "Arduino.h"
 #include "ArenaControl.h"
+#include "Controller.h"
+
+/* Everything the lightsaber duel needs to carry on, in one place so it
+ *    can be checkpointed (see Checkpoint.h). Timestamps, the field
+ *    window's included, are match time.
+ */
+struct Stage2State {
+   uint8_t  curState;                // enum states, in Stage2.cpp
+   uint8_t  nextState;
+   uint32_t nextStateTimestamp;
+   uint32_t hitTimeout;              // end of the hit flash, 0 if none
+   uint8_t  patternIndex;            // fighting pattern
+   uint8_t  patternStep;             // OFF time of the pattern being run
+   uint8_t  hitSlot;                 // hit report entry being run
+   uint8_t  lateHits;                // hits after their window closed
+   uint32_t windowOpen;              // when the field window opened
+   boolean  ignoreHits;
+   boolean  enableField;
+   boolean  fieldOn;
+   uint32_t saberColor;              // color of the whole lightsaber
+   char     hitReport[10];
+};
 
 class Stage2 
 {
    public:
-      Stage2();
+      Stage2(Controller &controller);
 
       void start(void);
       void stop(uint32_t timestamp);
-      void step(uint32_t timestamp);
+      ARENA_PROFILED void step(uint32_t timestamp);
       void report(void);
       int  score(void);
+      boolean idle(uint32_t timestamp);
+      uint32_t deadline(uint32_t timestamp);
+      uint8_t pattern(void);
+      const char *hits(void);
+      void printState(Print &out);
+      uint8_t state(void);
+      uint8_t hitCount(void);
+      uint8_t color(void);
+
+      void checkpoint(Stage2State &state);
+      void resume(const Stage2State &state);
+
+   private:
+      Controller &controller;
 };
 
 #endif
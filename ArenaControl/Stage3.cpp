@@ -6,84 +6,53 @@
  *
  ********************************************************************/
 
-#include <MsTimer2.h>
-
 #include "Arduino.h"
 #include "Stage3.h"
+#include "PinTrace.h"
 
-#include "SimplePinChange.h"
-
-#include "Stage1.h"
-extern Stage1 stage1;
-#include "Controller.h"
-extern Controller controller;
-
-#define ENCODER_A_PIN     3     // This one is an interrupt pin
-#define ENCODER_B_PIN     4     // This is a standard (not interrupt) pin
+#include "Quadrature.h"
+#include "Timebase.h"
+#include "DigitDecoder.h"
+#include "Scoring.h"
 
 #define ENABLE_LED_PIN    7
 #define RED_LED_PIN       8
 #define GREEN_LED_PIN     9
 #define BLUE_LED_PIN     10
 
-#define ONE_REVOLUTION  96
-#define ONE_CLICK        4
-#define TWO_CLICKS       8
-#define PLUS_MINUS       6
-
 #define CENTER_WHITE  0x0
 #define RIGHT_RED     0x1
 #define LEFT_BLUE     0x2
 
-static volatile long encoderValue = 0;          // updated by the encoder interrupt
-static int oldState = 0;                        // previous quadrature interrupt pin state
-static int blink = 0;                           // on/off value of blink led - updated by MsTimer2 irq
-static int blinkEnabled = true;                 // true if blink enabled (off after motion)
+#define BLINK_PERIOD     100                    // ms between toggles of the LED enable (5Hz blink)
 
-#define NOT_MOVED (4269)                        // 6*9 = 42, in base 13, Hitchiker's Guide to the Galaxy
-static int prevCenter = 1;                      // were we in the center on the last time we checked?
-static int prevTurns = 0;                       // previous number of turns (at last digit entered)
-static int prevPosition = NOT_MOVED;            // previous position (last time digit entered)
-static boolean enteringClockwise = 1;           // did we enter center in a clockwise direction?
-static boolean exitingClockwise = 0;            // did we exit center in a clockwise direction?
-static boolean lastDigitClockwise = true;       // was last digit entered in clockwise direction?
+static Stage3State knob;                        // the decoder, LEDs and turns pattern
 
-static uint16_t turnPattern = 0;                // turns pattern as chosen by stage 1 relays
-
-static int digitCounter = 0;                    // number of digits stored
 static char digitString[10] = { '\0' };         // Printable version of the digits stored
 static int stageScore = 0;                      // Stage score
 
-#define MAX_DIGITS_STORED 32                       // Maximum number of digits (only last 5 count)
-static uint8_t digits[MAX_DIGITS_STORED] = { 0 };  // digits stored on each cw/ccw or ccw/cw transition
+static boolean  speedStarted = false;           // speedPosition/speedEdge are set
+static long     speedPosition;                  // encoder count at the last motion
+static uint32_t speedEdge;                      // and the Timebase stamp of its edge
+static uint32_t peakSpeed = 0;                  // counts per second
 
-static void addDigit(void);
-static boolean inCenter(long);
-static boolean movementDetected(long *encoder, int *center);
-static void blinkQuadratureLEDs(void);
-static void updateEncoder(void);
+static void showMovement(boolean clockwise, boolean center);
+static void startBlink(uint32_t timestamp);
+static void stopBlink(void);
+static void updateBlink(uint32_t timestamp);
 static void calculateScore(void);
+static void measureSpeed(long encoder, uint32_t edge);
 
 
-Stage3::Stage3() 
+Stage3::Stage3(const uint16_t &turnPattern, Controller &controller) :
+   chosenPattern(turnPattern), controller(controller)
 {
 }
 
 void Stage3::start() 
 {
-  
-  /* Set both quadrature channels to input and turn on pullup resistors */
-  pinMode(ENCODER_A_PIN, INPUT_PULLUP); 
-  pinMode(ENCODER_B_PIN, INPUT_PULLUP);
-
-  /* Get the initial state of the two quadrature pins */
-  oldState = 0;
-  if (digitalRead(ENCODER_A_PIN)) oldState |= 1;
-  if (digitalRead(ENCODER_B_PIN)) oldState |= 2;
-
-  /* invoke interrupt routine on each edge of ENCODER_A_PIN */
-  SimplePinChange.attach(ENCODER_A_PIN, updateEncoder);
-  SimplePinChange.attach(ENCODER_B_PIN, updateEncoder);  
+  /* Start the quadrature decoder - interrupts on each edge of both channels */
+  Quadrature.start();
   
   /* Setup the quadrature encoder pin modes */
   pinMode(ENABLE_LED_PIN, OUTPUT);
@@ -91,28 +60,26 @@ void Stage3::start()
   pinMode(GREEN_LED_PIN,  OUTPUT);
   pinMode(BLUE_LED_PIN,   OUTPUT);
 
-  /* Start the blink at 5hz rate (200ms period, 100ms irq rate */
-  MsTimer2::set(100, blinkQuadratureLEDs);
-  MsTimer2::start();
-
-  /* Initial state of the LEDs is blinking white */
+  /* Initial state of the LEDs is blinking white, at a 5hz rate (200ms 
+   *   period) from the start of the match 
+   */
   digitalWrite(RED_LED_PIN,    LOW);
   digitalWrite(GREEN_LED_PIN,  LOW);
   digitalWrite(BLUE_LED_PIN,   LOW);
-  digitalWrite(ENABLE_LED_PIN, HIGH);
+  startBlink(0);
 
-  turnPattern = stage1.turnPattern;
+  knob.turnPattern = chosenPattern;
   
   Serial.print(F("pattern="));
-  Serial.println(turnPattern);
+  Serial.println(knob.turnPattern);
 }
 
 
 void Stage3::stop(uint32_t timestamp) 
 {
   /* Stop the blink LEDs */
-  MsTimer2::stop();
-  detachInterrupt(1);
+  stopBlink();
+  Quadrature.stop();
   delay(1);
 
   /* Turn off the leds and the blink so the knob is off at contest end */
@@ -127,104 +94,43 @@ void Stage3::stop(uint32_t timestamp)
 
 void Stage3::step(uint32_t timestamp) 
 {
-   long encoder;
-   int center;
-   int turns;
-
-   /* Check if motion was detected, and control the quadrature red/white/blue
-    *    LEDs. and to return the current encoder value.  We can't use a 'live'
-    *    encoder value below as we could have a race condition if the encoder
-    *    changed while in the code below
+   PIN_TRACE_STEP(PIN_TRACE_STAGE3);
+
+   long     encoder;
+   uint32_t edge;
+   boolean  clockwise;
+
+   /* Blink the knob LEDs until the first motion out of the center */
+   updateBlink(timestamp);
+
+   /* Take one consistent snapshot of the encoder. If it has not moved since
+    *    the last position the decoder saw, there is nothing to do
     */
-   if (!movementDetected(&encoder, &center)) {
+   encoder = Quadrature.read(edge);
+   if (encoder == knob.decoder.position()) {
+      encoderLatency.cancel();
       return;
    }
+   clockwise = (encoder > knob.decoder.position());
+   measureSpeed(encoder, edge);
 
 #if 0
-   if (!blinkEnabled) {
+   if (!knob.blinkEnabled) {
       Serial.print(F("encoder="));
       Serial.println(encoder);
    }
 #endif
 
-   /* General logic of the code below...
-    *  
-    *  We really only care if we are transitioning into, or out of, a center - no
-    *  other motion counts. This allows the robot to move the quadrature back and 
-    *  forth and all that motion is filtered out - until we cross a center.
-    *  
-    *  Once we cross into a center we need to store the the number of turns and
-    *  a flag indicating if we entered it clockwise or counterclockwise
-    *  
-    *  Once we exit a center, if we exit it in the same direction we entered it,
-    *  we have nothing to do (just continuing motion in the same direction). However,
-    *  if we exit it in a different direction than we entered, we are entering a
-    *  digit. The only extra issue here is to verify we are entereing digits in a
-    *  clockwise, counterclockwise sequence.
-    *  
-    *  Note that if we start off moving in a counterclockwize direction the first
-    *  time, we are lost, and the system will not recover - this is an error state
-    *  as defined in the rules (must start clockwise).
+   /* Hand the new position to the digit decoder. It walks every count
+    *    since the last position it saw, so center crossings are found no
+    *    matter how long it has been since the last step, and it keeps the
+    *    turn and in-revolution offset up to date without any division. 
+    *    See DigitDecoder for the details of how digits are recognized.
     */
-    
-    /* Are we currently in a center region? */
-    if (center) {
-      
-      /* did we just transition into center on this step? */
-      if (!prevCenter) {
-         turns = ((encoder > 0) ? (encoder + (ONE_REVOLUTION/2))
-                                : (encoder - (ONE_REVOLUTION/2))) / ONE_REVOLUTION;
-         enteringClockwise = (encoder < (turns*ONE_REVOLUTION));
-#if 1 
-         Serial.print(F("Entering center @ "));
-         Serial.print(encoder);
-         Serial.print(F(", turns="));
-         Serial.print(turns);
-         Serial.print(F(", enteringClockwise="));
-         Serial.println(enteringClockwise);
-#endif
+   knob.decoder.feed(encoder);
 
-         prevTurns = turns;
-      }
-
-   /* we are not in the center */
-   } else {
-
-      /* did we just transition out of the center on this step? */
-      if (prevCenter) {
-
-         exitingClockwise = (encoder > (prevTurns*ONE_REVOLUTION));
-#if 1
-         Serial.print(F("Exiting center @ "));
-         Serial.print(encoder);
-         Serial.print(F(", exitingClockwise="));
-         Serial.println(exitingClockwise);
-#endif
-
-         /* If we entered, then exited the center in opposite directions
-          * then we have just dialed a digit
-          */
-         if (enteringClockwise != exitingClockwise) {
-
-#if 1
-            Serial.print(F("lastDigitClockwise "));
-            Serial.println(lastDigitClockwise);
-            Serial.print(F("prevturns "));
-            Serial.println(prevTurns);
-#endif
-
-            /* However, we only count digits entered in alternating
-             * clockwise and counterclockwise directions
-             */
-            if (lastDigitClockwise != exitingClockwise) {
-               addDigit();
-            }
-         }
-      }
-   }  
-
-   /* Save our previous center state for our next time */
-   prevCenter = center;
+   /* Control the quadrature red/white/blue LEDs */
+   showMovement(clockwise, knob.decoder.inCenter());
 }
 
 
@@ -235,6 +141,10 @@ void Stage3::report(void)
    Serial.println(stageScore);
    Serial.print(F("Digits entered: "));
    Serial.println(digitString);
+   Serial.print(F("PEAK SPEED: "));
+   Serial.print(peakSpeed);
+   Serial.println(F(" counts/sec"));
+   encoderLatency.report(F("encoder->LED"));
    
    if (controller.attached()) {
       controller.lcdp()->setCursor(0,3);
@@ -254,56 +164,83 @@ int Stage3::score(void)
 }
 
 
-/* This handles the logic of adding a digit, calculating the digit value
- *  from the current and previous positions. This was broken out of the 
- *  rest of the code so it can be called for the last digit from the report
- *  function
+/* Nothing to do until an interrupt if the decoder has seen every count.
+ *    The blink toggles are deadline()'s, seen on the pass after the
+ *    Timer0 wake that follows them.
  */
-static void addDigit(void)
+boolean Stage3::idle(uint32_t timestamp)
 {
-#if 1
-   Serial.print(F("prevPosition="));
-   Serial.println(prevPosition);
-#endif
+  return Quadrature.read() == knob.decoder.position();
+}
 
-   /* If this is the first digit, the digit is just the number of turns */
-   if (prevPosition == NOT_MOVED) {
-       digits[digitCounter] = prevTurns;
 
-    /* Else we need to subtract the last position to get the delta number of
-     *  turns. We have tow cases here - traveling clockwise or counterclockwise
-     */
-    } else if (enteringClockwise) {
-       digits[digitCounter] = prevTurns - prevPosition;
-    } else {
-       digits[digitCounter] = prevPosition - prevTurns;
-    }
+/* The next blink toggle, while the LEDs blink */
+uint32_t Stage3::deadline(uint32_t timestamp)
+{
+  return knob.blinkEnabled ? knob.blinkToggleTime + BLINK_PERIOD : MATCH_RUNTIME;
+}
 
-#if 1
-    Serial.print(F("Adding digit: ")); 
-    Serial.println(digits[digitCounter]);
-#endif
 
-    /* Update our global variables for the next digit */
-    lastDigitClockwise = exitingClockwise;
-    prevPosition = prevTurns;
-    digitCounter++;
+/* The digits as reported, for the result log */
+const char *Stage3::digits(void)
+{
+  return digitString;
 }
 
 
-static boolean inCenter(long enc) 
+/* The encoder position the digit decoder has caught up with */
+long Stage3::position(void)
 {
-   int relativeEncoder;
-   
-   /* Calculate the relative value +/- from center position */
-   relativeEncoder = (int) (abs(enc) % ONE_REVOLUTION);
-   if (relativeEncoder > (ONE_REVOLUTION / 2)) {
-      relativeEncoder -= ONE_REVOLUTION;
-   }
-   
+  return knob.decoder.position();
+}
+
+
+/* The digits dialed so far, as they would be scored now (the last digit
+ *    is only added once the knob leaves the center, or at the end)
+ */
+void Stage3::printDigits(Print &out)
+{
+  uint8_t digits[SCORE_DIGITS];
+  uint8_t count = knob.decoder.lastDigits(digits, SCORE_DIGITS);
 
-   /* Center is true if we are +/- a small margin of the center */
-   return abs(relativeEncoder) <= PLUS_MINUS;   
+  if (0 == count) {
+     out.print(F("--none--"));
+  }
+  for (uint8_t n=0; n < count; n++) {
+     out.print((char) ((digits[n] <= 9) ? (digits[n] + '0') : '?'));
+  }
+}
+
+
+/* The knob LED pins as driven - D7 (enable) in bit 0, then red, green
+ *    and blue on D8-D10 - read back from the port input registers
+ */
+uint8_t Stage3::leds(void)
+{
+  return ((PIND >> ENABLE_LED_PIN) & 0x01) | ((PINB & 0x07) << 1);
+}
+
+
+/* Copy of the knob state for a checkpoint, with the encoder count */
+void Stage3::checkpoint(Stage3State &state)
+{
+  state = knob;
+  state.encoder = Quadrature.read();
+}
+
+
+/* Carry on from a checkpoint, after start() - the encoder count carries
+ *    on from the last one before the reset (see Quadrature.h), or from
+ *    the checkpoint's, and the knob LEDs pick up at the next step
+ */
+void Stage3::resume(const Stage3State &state)
+{
+  knob = state;
+
+  if (!Quadrature.resume(state.encoder)) {
+     Serial.print(F("ENCODER: resumed from the checkpoint\n"));
+  }
+  digitalWrite(ENABLE_LED_PIN, knob.blinkEnabled ? knob.blinkOn : HIGH);
 }
 
 
@@ -314,145 +251,117 @@ static void calculateScore(void) {
 
    int loop;
    int numDigits;
-   int numCorrect = 0;
-   uint16_t pattern;
-   int goodDigitPoints[] = { 0, 45, 95, 155, 230, 325 };
-   int powersOfTen[] = { 10000, 1000, 100, 10, 1 };
+   uint8_t digits[SCORE_DIGITS];
 
-   /* If we are in the center and moved (no longer blinking), then
-    * don't forget to add in the last digit before calculating the score
+   /* Catch the decoder up with the final position, then if we are in the
+    * center and moved, don't forget to add in the last digit before
+    * calculating the score
     */
-   if (!blinkEnabled && inCenter(encoderValue)) {
+   knob.decoder.feed(Quadrature.read());
+   if (knob.decoder.finish()) {
       Serial.println(F("Adding last digit"));
-      addDigit();
    }
    
    /* Handle the trivial case of no digits entered */   
-   if (digitCounter <= 0) {
+   numDigits = knob.decoder.lastDigits(digits, SCORE_DIGITS);
+   if (numDigits <= 0) {
       strcpy(digitString, "--none--");
       stageScore = 0;
       return;
    }
 
-   /* Else loop through all digits in the wrap-around buffer, 
-    * converting to printable digits
-    */
-   numDigits = (digitCounter > 5) ? 5 : digitCounter;
-   for (loop=numDigits-1; loop >= 0; loop--) {
-      digitCounter--;
-      if (digitCounter < 0) {
-         digitCounter += MAX_DIGITS_STORED;
-      }
+   /* Else loop through the last (up to) 5 digits, converting to printable digits */
+   for (loop=0; loop < numDigits; loop++) {
 
       /* Handle values outside of [0..9] so not converted to non-printable ASCII */
-      if ((digits[digitCounter] >= 0) && (digits[digitCounter] <= 9)) {
-         digitString[loop] = digits[digitCounter] + '0';
+      if (digits[loop] <= 9) {
+         digitString[loop] = digits[loop] + '0';
       } else {
          digitString[loop] = '?';
       }
    }
+   digitString[numDigits] = '\0';
    
 #if 1
    Serial.print(F("pattern="));
-   Serial.println(turnPattern);
+   Serial.println(knob.turnPattern);
 #endif
 
-   /* Now loop through the digits and count how many are correct */
-   pattern = turnPattern;
-   for (loop=0; loop < numDigits; loop++) {
-      int expected = (pattern / powersOfTen[loop]) % 10;
-      int found    = digitString[loop] - '0';
-      if (expected == found) {
-         numCorrect++;
+   /* Score the digits as printed - see Scoring.h */
+   stageScore = stage3Score(digitString, numDigits, knob.turnPattern);
+}
+
+
+/* Knob speed from one motion to the next, timed by the Timebase stamps of
+ *    the last edge of each, so how often step() runs does not come into
+ *    it. The first motion after a rest is timed from the end of the last
+ *    one, and reads low.
+ */
+static void measureSpeed(long encoder, uint32_t edge)
+{
+   uint32_t counts = labs(encoder - speedPosition);
+   uint32_t ticks  = edge - speedEdge;
+
+   if (speedStarted && (0 != ticks) && (counts < 1000)) {
+      uint32_t speed = (counts * (1000L * TIMEBASE_TICKS_PER_MS)) / ticks;
+      if (speed > peakSpeed) {
+         peakSpeed = speed;
       }
    }
-
-#if 1
-   Serial.print(F("Num digits correct "));
-   Serial.println(numCorrect);
-#endif
-   
-   /* Map the number of correct digits to the stage 3 score */
-   stageScore = goodDigitPoints[numCorrect];
+   speedStarted  = true;
+   speedPosition = encoder;
+   speedEdge     = edge;
 }
 
 
-uint32_t movementHistory = 0;
-long prevEncoderValue = 0;
-
 #define MOVEMENT_HISTORY_SIZE  4
 #define MOVEMENT_MASK_WIDTH    2
 #define MOVEMENT_HISTORY_MASK  ((1 << MOVEMENT_MASK_WIDTH) - 1)
 
+/* Majority vote of the 4x 2-bit movement history fields, precomputed for
+ *    every value of the history byte. Each RIGHT_RED field votes right and
+ *    each LEFT_BLUE field votes left (empty fields, cleared in the center,
+ *    do not vote), and the LEDs go blue only if left wins outright.
+ */
+#define FIELD(h,n)        (((h) >> ((n) * MOVEMENT_MASK_WIDTH)) & MOVEMENT_HISTORY_MASK)
+#define VOTE(h,n)         ((RIGHT_RED == FIELD(h,n)) - (LEFT_BLUE == FIELD(h,n)))
+#define MAJORITY(h)       (((VOTE(h,0) + VOTE(h,1) + VOTE(h,2) + VOTE(h,3)) < 0) ? LEFT_BLUE : RIGHT_RED)
+#define MAJORITY_4(h)     MAJORITY(h),      MAJORITY(h+1),     MAJORITY(h+2),     MAJORITY(h+3)
+#define MAJORITY_16(h)    MAJORITY_4(h),    MAJORITY_4(h+4),   MAJORITY_4(h+8),   MAJORITY_4(h+12)
+#define MAJORITY_64(h)    MAJORITY_16(h),   MAJORITY_16(h+16), MAJORITY_16(h+32), MAJORITY_16(h+48)
+
+static const uint8_t directionMajority[256] PROGMEM = {
+   MAJORITY_64(0), MAJORITY_64(64), MAJORITY_64(128), MAJORITY_64(192)
+};
+
 /*
- * This function is called to turn the encoder value into a true/false
- * is in center flag and to track the last 'MOVEMENT_HISTORY_SIZE' 
+ * This function is called with the direction of the latest motion and
+ * the in center flag, and tracks the last 'MOVEMENT_HISTORY_SIZE' 
  * number of motions to determine if we are moving left or right. This
  * is needed to filter out small motions left/right causing the LEDs 
  * in teh quadrathre to light up red/blue - this is only for visual use
  * and nothing more.
  */
-static boolean movementDetected(long *encoder, int *center) 
+static void showMovement(boolean clockwise, boolean center) 
 {
-   int loop; 
-   int curDirection;
-   int rightMotion  = 0;
-   int leftMotion   = 0;
+   uint8_t curDirection;
      
-   /* If no motion, then return with nothing else to do */
-   *encoder = encoderValue;
-   if (prevEncoderValue == *encoder) {
-       return false;
-    }
-   
    /* if we are center, then set the quadrature LEDs to white and wipe
     * out all past history. This is needed as if we are moving right to 
     * white, then reverse to left, we have more right motion than left 
     * and can temporarily light the LEDs the wrong color
     */
-   *center = inCenter(*encoder);   
-   if (*center) {
+   if (center) {
       curDirection = CENTER_WHITE;
-      movementHistory = 0;
+      knob.movementHistory = 0;
    
    /* Else if not int the center, we keep a running history of the last 'N'
-      movement directions to average out small +/- movements setting the color
+    *    movement directions to average out small +/- movements setting the 
+    *    color, and a single table lookup gives the majority direction
     */   
    } else {
-     
-      /* convert the current position to either center, or left/right of center */
-      if (prevEncoderValue < *encoder) {
-         curDirection = RIGHT_RED;
-      } else {
-         curDirection = LEFT_BLUE;
-      } 
- 
-      /* movement history contains the history of last 'n' movements */
-      movementHistory <<= MOVEMENT_MASK_WIDTH;
-      movementHistory |= curDirection;
-      movementHistory &= ((1 << (MOVEMENT_MASK_WIDTH*MOVEMENT_HISTORY_SIZE)) - 1);
-     
-      /* count the left and right movements to determine the major move direction */
-      uint32_t history = movementHistory; 
-     
-      /* count number of 1 (right) or 0 (left) bits to determine the average direction */
-      for (loop=0; loop < MOVEMENT_HISTORY_SIZE; loop++) {
-         if ((history & MOVEMENT_HISTORY_MASK) == RIGHT_RED) {
-            rightMotion++;
-         } else if ((history & MOVEMENT_HISTORY_MASK) == LEFT_BLUE) {
-            leftMotion++; 
-         }
-         history >>= MOVEMENT_MASK_WIDTH;
-      }
-
-      /* if we are currently at center, light the LED white, else red or 
-       *   blue based on the motion counts above
-       */
-      if (leftMotion > rightMotion) {
-         curDirection = LEFT_BLUE;
-      } else {
-         curDirection = RIGHT_RED;
-      }
+      knob.movementHistory = (knob.movementHistory << MOVEMENT_MASK_WIDTH) | (clockwise ? RIGHT_RED : LEFT_BLUE);
+      curDirection = pgm_read_byte(&directionMajority[knob.movementHistory]);
    }
    
    /* Tricky code to handle the 3x conditions of red, white and blue for
@@ -463,99 +372,43 @@ static boolean movementDetected(long *encoder, int *center)
    digitalWrite(GREEN_LED_PIN, !(CENTER_WHITE == curDirection));
    digitalWrite(RED_LED_PIN,   !(LEFT_BLUE    != curDirection));
    digitalWrite(BLUE_LED_PIN,  !(RIGHT_RED    != curDirection));
+   encoderLatency.output();
 
    /* If we moved out of the center area, disable blinking of the LEDs */
-   if ((CENTER_WHITE != curDirection) && (blinkEnabled)) {
-      blinkEnabled = false;
+   if ((CENTER_WHITE != curDirection) && (knob.blinkEnabled)) {
+      stopBlink();
    }
-
-   /* update previous encoder value for the next iteration */
-   prevEncoderValue = *encoder;
-
-   /* return true indicating we did have motion */
-   return true;
 }  
 
 
-/* Toggle the quadrature LEDs on and off This function is invoked via
- *    the a timeout counter callback at a rate of 10Hz (100ms) to generate
- *    a 5Hz blink rate.
+/* Blink the quadrature LEDs by toggling the enable line every BLINK_PERIOD
+ *    ms of match time. This is polled from Stage3::step rather than run from
+ *    a timer interrupt - the enable line (D7) has no timer output compare
+ *    pin to drive it in hardware, and a compare in the loop is far cheaper
+ *    than an interrupt that can delay the encoder ISR. Timer2 is left free.
  */
-static void blinkQuadratureLEDs() {
-  static boolean onOff = HIGH;
-  
-  /* if blink is enabled, then toggle the enable line */
-  if (blinkEnabled) {
-     digitalWrite(ENABLE_LED_PIN, onOff);
-     onOff = !onOff;
-     
-  /* else turn off the blink timer and set the enable pin to always on */
-  } else {
-     MsTimer2::stop();
-     digitalWrite(ENABLE_LED_PIN, HIGH);
-  }
+static void startBlink(uint32_t timestamp)
+{
+   knob.blinkEnabled    = true;
+   knob.blinkOn         = HIGH;
+   knob.blinkToggleTime = timestamp;
+   digitalWrite(ENABLE_LED_PIN, knob.blinkOn);
 }
 
 
-/* This quadrature encoder interrupt handler is based heavily
- *   on an the implementation in the Encoder library at:
- *
- *     https://www.pjrc.com/teensy/td_libs_Encoder.html
- *
- * First an overview of the two lines in a quadrature encoder:
- *               _____       _____
- *   Pin1:  ____|     |_____|     |____
- *            _____       _____       _  
- *   Pin2:  _|     |_____|     |_____|
- *
- *        <--- negative     positive --->
- *
- * By examining the current two pins and the two previous
- *    pins, we can determine the position and amount of
- *    motion (assume we can respond fast enough to only 
- *    lose at most 1 transition).
- *
- *   new    new    old    old
- *   pin2   pin1   pin2   pin1   Result
- *   ----   ----   ----   ----   ------
- *    0      0      0      0     no movement
- *    0      0      0      1     +1
- *    0      0      1      0     -1
- *    0      0      1      1     +2
- *    0      1      0      0     -1
- *    0      1      0      1     no movement
- *    0      1      1      0     -2
- *    0      1      1      1     +1
- *    1      0      0      0     +1
- *    1      0      0      1     -2
- *    1      0      1      0     no movement
- *    1      0      1      1     -1
- *    1      1      0      0     +2
- *    1      1      0      1     -1
- *    1      1      1      0     +1
- *    1      1      1      1     no movement
- *   ----   ----   ----   ----   ------
- */
-
-/* state change based on table above */
-static const int stateChange[16] = 
-{  
-   0, +1, -1, +2, -1,  0, -2, +1, 
-  +1, -2,  0, -1, +2, -1, +1,  0 
-};
-
-static void updateEncoder(void) 
+/* Stop blinking and leave the enable pin always on */
+static void stopBlink(void)
 {
-  /* Build up the 4bit state of current and past pin values */
-  uint8_t state = oldState & 3;
-  if (digitalRead(ENCODER_A_PIN)) state |= 4;
-  if (digitalRead(ENCODER_B_PIN)) state |= 8;
-
-  /* Based on 4-bit state value, update encoder value */
-  encoderValue += stateChange[state];  
-
-  /* Save our current two pins for the next interrupt */
-  oldState = (state >> 2);
+   knob.blinkEnabled = false;
+   digitalWrite(ENABLE_LED_PIN, HIGH);
 }
 
 
+static void updateBlink(uint32_t timestamp)
+{
+   if (knob.blinkEnabled && ((timestamp - knob.blinkToggleTime) >= BLINK_PERIOD)) {
+      knob.blinkOn = !knob.blinkOn;
+      knob.blinkToggleTime = timestamp;
+      digitalWrite(ENABLE_LED_PIN, knob.blinkOn);
+   }
+}
@@ -14,17 +14,45 @@
 
 #include "Arduino.h"
 #include "ArenaControl.h"
+#include "DigitDecoder.h"
+#include "Controller.h"
+
+/* Everything the knob needs to carry on, in one place so it can be
+ *    checkpointed (see Checkpoint.h)
+ */
+struct Stage3State {
+   DigitDecoder decoder;             // turns encoder positions into digits
+   long     encoder;                 // Quadrature count, in a checkpoint
+   uint16_t turnPattern;             // turns pattern as chosen by stage 1 relays
+   uint8_t  movementHistory;         // last few directions, for the LED color
+   boolean  blinkEnabled;            // true if blink enabled (off after motion)
+   boolean  blinkOn;                 // current state of the blinking enable line
+   uint32_t blinkToggleTime;         // match time of the last toggle
+};
 
 class Stage3 
 {
    public:
-      Stage3();
+      Stage3(const uint16_t &turnPattern, Controller &controller);
 
       void start(void);
       void stop(uint32_t timestamp);
-      void step(uint32_t timestamp);
+      ARENA_PROFILED void step(uint32_t timestamp);
       void report(void);
       int  score(void);
+      boolean idle(uint32_t timestamp);
+      uint32_t deadline(uint32_t timestamp);
+      const char *digits(void);
+      long position(void);
+      void printDigits(Print &out);
+      uint8_t leds(void);
+
+      void checkpoint(Stage3State &state);
+      void resume(const Stage3State &state);
+
+   private:
+      const uint16_t &chosenPattern;    // as stage 1 chose it, read at start()
+      Controller     &controller;
 };
 
 #endif
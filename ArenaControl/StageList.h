@@ -0,0 +1,113 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - StageList.h
+ *
+ * This is the header file for the list of match stages.
+ *
+ * StageList<Stage1, Stage2, Stage3> holds a reference to one object
+ * of each stage type, runs start/step/stop/report on them in the
+ * order listed and adds up their scores. Each call is resolved at
+ * compile time and inlined - there are no virtual functions, and
+ * the code is what the calls written out one after the other would
+ * be. The list is a constexpr object, so even the references to the
+ * stages are folded into the calls. A stage type only needs these
+ * methods:
+ *
+ *    void start(void);
+ *    void step(uint32_t timestamp);
+ *    void stop(uint32_t timestamp);
+ *    void report(void);
+ *    int  score(void);
+ *    bool idle(uint32_t timestamp);
+ *    uint32_t deadline(uint32_t timestamp);
+ *
+ * so adding a stage is adding its type (and its object) to the
+ * list. A stage that needs something of another one (stage 3 needs
+ * the turn pattern stage 1 chose) is handed a reference to it when
+ * it is constructed, and comes after it in the list.
+ *
+ * idle() is true if the stage has nothing to do until an interrupt
+ * comes in or match time moves on - the list is idle if every stage
+ * is, and loop() then sleeps (see Idle.h). It is called with
+ * interrupts off, after the steps of the pass.
+ *
+ * deadline() is the match time of the next thing an idle stage does
+ * with no input (the end of the match if nothing), the earliest of
+ * them for the list. The arena wakes every ms and has no use for
+ * it, but the host tournament (HostTools/arenatourney) skips its
+ * virtual clock ahead to it.
+ *
+ ********************************************************************/
+
+#ifndef StageList_h
+#define StageList_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+
+template <typename... Stages> class StageList;
+
+/* The end of the list */
+template <>
+class StageList<>
+{
+   public:
+      constexpr StageList() {}
+
+      inline void start(void) const {}
+      inline void step(uint32_t timestamp) const {}
+      inline void stop(uint32_t timestamp) const {}
+      inline void report(void) const {}
+      inline int  score(void) const { return 0; }
+      inline bool idle(uint32_t timestamp) const { return true; }
+      inline uint32_t deadline(uint32_t timestamp) const { return MATCH_RUNTIME; }
+};
+
+/* The first stage, then the rest of the list */
+template <typename First, typename... Rest>
+class StageList<First, Rest...>
+{
+   public:
+      constexpr StageList(First &first, Rest &... rest) : first(first), rest(rest...) {}
+
+      inline void start(void) const {
+         first.start();
+         rest.start();
+      }
+
+      inline void step(uint32_t timestamp) const {
+         first.step(timestamp);
+         rest.step(timestamp);
+      }
+
+      inline void stop(uint32_t timestamp) const {
+         first.stop(timestamp);
+         rest.stop(timestamp);
+      }
+
+      inline void report(void) const {
+         first.report();
+         rest.report();
+      }
+
+      inline int score(void) const {
+         return first.score() + rest.score();
+      }
+
+      inline bool idle(uint32_t timestamp) const {
+         return first.idle(timestamp) && rest.idle(timestamp);
+      }
+
+      inline uint32_t deadline(uint32_t timestamp) const {
+         uint32_t mine   = first.deadline(timestamp);
+         uint32_t theirs = rest.deadline(timestamp);
+
+         return ((int32_t) (mine - theirs) < 0) ? mine : theirs;
+      }
+
+   private:
+      First                    &first;
+      const StageList<Rest...>  rest;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Telemetry.cpp
+ *
+ * This is the code file for the match telemetry stream.
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Telemetry.h"
+#include "PinTrace.h"
+#include "Quadrature.h"
+#include "Timebase.h"
+
+
+TelemetryStream::TelemetryStream(Stage2 &stage2, Stage3 &stage3) :
+   stage2(stage2), stage3(stage3)
+{
+   slot = 0xFFFFFFFF;
+   passes = 0;
+   lastCost = 0;
+   frames = 0;
+   skipped = 0;
+   costMax = 0;
+   costTotal = 0;
+}
+
+
+/* Every loop() pass of the match - a frame at each multiple of the frame
+ *    period of match time. A pass that comes late still sends only the
+ *    one frame, so the stream never runs behind.
+ */
+void TelemetryStream::step(uint32_t timestamp)
+{
+   PIN_TRACE_STEP(PIN_TRACE_TELEMETRY);
+
+#if TELEMETRY_HZ
+   passes++;
+   if ((timestamp / (MSECS / TELEMETRY_HZ)) != slot) {
+      slot = timestamp / (MSECS / TELEMETRY_HZ);
+      send(timestamp);
+   }
+#endif
+}
+
+
+void TelemetryStream::report(void)
+{
+#if TELEMETRY_HZ
+   Serial.print(F("TELEMETRY: "));
+   Serial.print(frames);
+   Serial.print(F(" frames, "));
+   Serial.print(skipped);
+   Serial.print(F(" skipped, mean "));
+   Serial.print(frames ? costTotal / frames : 0);
+   Serial.print(F(" us, longest "));
+   Serial.print(costMax);
+   Serial.print(F(" us\n\n"));
+#endif
+}
+
+
+void TelemetryStream::send(uint32_t timestamp)
+{
+   uint32_t       began = Timebase.ticks();
+   TelemetryFrame frame;
+
+   if (Serial.availableForWrite() < (int) sizeof(frame)) {
+      skipped++;
+      return;
+   }
+
+   frame.type      = TELEMETRY_FRAME;
+   frame.state     = stage2.state();
+   frame.encoder   = (int16_t) Quadrature.read();
+   frame.matchTime = timestamp;
+   frame.more      = TELEMETRY_MORE;
+   frame.hits      = stage2.hitCount();
+   frame.saber     = stage2.color();
+   frame.leds      = stage3.leds();
+   frame.loops     = passes;
+   frame.cost      = lastCost;
+   Serial.write((const uint8_t *) &frame, sizeof(frame));
+   passes = 0;
+
+   lastCost = (Timebase.ticks() - began) / TIMEBASE_TICKS_PER_US;
+   if (lastCost > costMax) {
+      costMax = lastCost;
+   }
+   costTotal += lastCost;
+   frames++;
+}
@@ -0,0 +1,77 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Telemetry.h
+ *
+ * This is the header file for the match telemetry stream.
+ *
+ * With TELEMETRY_HZ set, a 16-byte binary frame of the match state
+ * goes out of the serial port TELEMETRY_HZ times a second of match
+ * time, along with the text log (and the input trace, if it is on).
+ * HostTools/arenatelemetry pulls the frames out of a capture of the
+ * port and writes them out as a time series to plot.
+ *
+ * A frame is two 8-byte records in the framing of the input trace
+ * (see Trace.h) - the first byte of each has the high bit set, and
+ * the types follow the trace record types - so a capture splits
+ * into the text log, the trace and the frames, and the tools that
+ * only know the trace skip the frames.
+ *
+ * A frame is built from fixed fields, with no loops, and is only
+ * sent if it fits in the serial transmit buffer there and then; if
+ * it does not (the text log has filled the buffer), that frame is
+ * skipped and counted rather than waited for. What each frame took,
+ * on the Timebase, goes out in the next frame and into the report.
+ * At 9600 baud, 20 frames a second take a third of the port.
+ *
+ ********************************************************************/
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Stage2.h"
+#include "Stage3.h"
+
+#define TELEMETRY_FRAME   0x90    // first record of a frame
+#define TELEMETRY_MORE    0x91    // second record
+
+/* One frame - 16 bytes, no padding on either the UNO or the host */
+struct TelemetryFrame {
+   uint8_t  type;               // TELEMETRY_FRAME
+   uint8_t  state;              // lightsaber state (enum states, Stage2.cpp)
+   int16_t  encoder;            // Quadrature count, low 16 bits
+   uint32_t matchTime;          // ms
+   uint8_t  more;               // TELEMETRY_MORE
+   uint8_t  hits;               // vibration edges the duel has yet to take
+   uint8_t  saber;              // lightsaber color, RGB 3-3-2
+   uint8_t  leds;               // knob LED pins, D7 (enable) in bit 0 to D10
+   uint16_t loops;              // loop() passes since the last frame
+   uint16_t cost;               // us to build and send the last frame
+};
+
+class TelemetryStream
+{
+   public:
+      TelemetryStream(Stage2 &stage2, Stage3 &stage3);
+
+      void step(uint32_t timestamp);
+      void report(void);
+
+   private:
+      void send(uint32_t timestamp);
+
+      Stage2  &stage2;
+      Stage3  &stage3;
+      uint32_t slot;            // match time / frame period of the last frame
+      uint16_t passes;          // loop() passes since the last frame
+      uint16_t lastCost;        // us
+      uint16_t frames;
+      uint16_t skipped;
+      uint16_t costMax;         // us
+      uint32_t costTotal;       // us
+};
+
+extern TelemetryStream Telemetry;
+
+#endif
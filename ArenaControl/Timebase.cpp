@@ -0,0 +1,39 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Timebase.cpp
+ *
+ * This is the code file for the input event timebase.
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Timebase.h"
+#include "PinTrace.h"
+
+TimebaseClass Timebase;
+
+volatile uint16_t TimebaseClass::overflows = 0;
+
+
+/* The Arduino core leaves Timer1 in 8-bit phase correct PWM mode at /64.
+ *    Put it in normal mode at /8 (2MHz), counting from 0.
+ */
+void TimebaseClass::start(void)
+{
+   TIMSK1    = 0;
+   TCCR1A    = 0;
+   TCCR1B    = bit(CS11);
+   TCNT1     = 0;
+   overflows = 0;
+   TIFR1     = bit(TOV1);
+   TIMSK1    = bit(TOIE1);
+}
+
+
+/* Every 32.768ms - the upper half of ticks() */
+ISR(TIMER1_OVF_vect)
+{
+   PIN_TRACE_ISR(PIN_TRACE_TIMEBASE);
+
+   TimebaseClass::overflows++;
+}
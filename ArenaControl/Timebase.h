@@ -0,0 +1,67 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Timebase.h
+ *
+ * This is the header file for the input event timebase.
+ *
+ * Timer1 free runs at F_CPU/8, so its count goes up every 0.5us,
+ * and its overflow interrupt counts the upper 16 bits. ticks() is
+ * the 32-bit count of half microseconds since start(), which wraps
+ * after about 35 minutes - long after a match is over - so times
+ * are compared by their difference, like millis(). It is safe to
+ * call from an interrupt routine and costs about 20 cycles there,
+ * so the vibration and encoder interrupts stamp their edges with
+ * it. micros() only moves in 4us steps and takes twice as long.
+ *
+ * Nothing else in the sketch uses Timer1: the sampled quadrature
+ * mode uses Timer2, and the knob LEDs on D9/D10 (the Timer1 PWM
+ * pins) are plain digital outputs.
+ *
+ ********************************************************************/
+
+#ifndef Timebase_h
+#define Timebase_h
+
+#include <util/atomic.h>
+
+#include "Arduino.h"
+#include "ArenaControl.h"
+
+#define TIMEBASE_TICKS_PER_US   2
+#define TIMEBASE_TICKS_PER_MS   (1000L * TIMEBASE_TICKS_PER_US)
+
+class TimebaseClass
+{
+   public:
+      static void start(void);
+
+      /* Timer1 count, with the overflow count on top. An overflow whose
+       *    interrupt has not run yet (interrupts are off, or the count
+       *    wrapped just before it was read) shows in TOV1, and then a
+       *    low count means the wrap came before the read.
+       */
+      static inline uint32_t ticks(void) {
+         uint16_t count;
+         uint16_t high;
+
+         ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = TCNT1;
+            high  = overflows;
+            if ((TIFR1 & bit(TOV1)) && (count < 0x8000)) {
+               high++;
+            }
+         }
+         return ((uint32_t) high << 16) | count;
+      }
+
+      /* True once the ticks() time 'at' has come */
+      static inline boolean passed(uint32_t at) {
+         return (int32_t) (ticks() - at) >= 0;
+      }
+
+      static volatile uint16_t overflows;   // counted by the overflow interrupt
+};
+
+extern TimebaseClass Timebase;
+
+#endif
@@ -0,0 +1,127 @@
+/********************************************************************
+ *
+ * SoutheastCon 2017 Arena control - Trace.cpp
+ *
+ * This is the code file for the match input trace. 
+ *
+ ********************************************************************/
+
+#include "Arduino.h"
+#include "Trace.h"
+
+TraceLog Trace;
+
+#if TRACE_RECORD
+/* Kept across a reset - set up by begin(), or picked up by resume() */
+TraceRecord       TraceLog::ring[TRACE_RING] ARENA_NOINIT;
+volatile uint8_t  TraceLog::head ARENA_NOINIT;
+volatile uint8_t  TraceLog::tail ARENA_NOINIT;
+volatile uint16_t TraceLog::lost ARENA_NOINIT;
+#endif
+
+
+TraceLog::TraceLog()
+{
+#if TRACE_RECORD
+   resumeSlot = 0;
+   lastButtons = 0;
+#endif
+}
+
+
+/* Start of the trace, first thing in setup() so the seed is recorded
+ *    before any stage uses it
+ */
+void TraceLog::begin(uint16_t seed)
+{
+#if TRACE_RECORD
+   head = 0;
+   tail = 0;
+   lost = 0;
+#endif
+   event(TRACE_START, TRACE_VERSION, seed);
+   flush();
+}
+
+
+/* First thing in the setup() of a resumed match, before any interrupt
+ *    that records inputs is on - send the records the ring held at the
+ *    reset, then keep a slot for the RESUME record ahead of anything
+ *    this boot records. resumed() fills it in.
+ */
+void TraceLog::resume(void)
+{
+#if TRACE_RECORD
+   head &= TRACE_RING - 1;
+   tail &= TRACE_RING - 1;
+   flush();
+   resumeSlot = head;
+   event(TRACE_RESUME, 0, 0);
+#endif
+}
+
+
+/* The encoder has its count back - fill in the RESUME record. It goes
+ *    out with the next flush.
+ */
+void TraceLog::resumed(uint8_t pins, uint16_t count)
+{
+#if TRACE_RECORD
+   ring[resumeSlot].data  = pins;
+   ring[resumeSlot].value = count;
+#endif
+}
+
+
+/* Record an event from outside an interrupt routine */
+void TraceLog::event(uint8_t type, uint8_t data, uint16_t value)
+{
+#if TRACE_RECORD
+   noInterrupts();
+   input(type, data, value);
+   interrupts();
+#endif
+}
+
+
+/* Once per loop() pass - mark the pass, record any button change and 
+ *    send everything buffered since the last pass
+ */
+void TraceLog::loop(uint32_t timestamp, int buttons)
+{
+#if TRACE_RECORD
+   event(TRACE_LOOP, 0, (uint16_t) timestamp);
+   if (buttons != lastButtons) {
+      lastButtons = buttons;
+      event(TRACE_BUTTONS, buttons, 0);
+   }
+   flush();
+#endif
+}
+
+
+/* Write the buffered records to the serial port. The interrupt routines
+ *    only move 'head', so the records between 'tail' and 'head' are
+ *    stable while they are written out.
+ */
+void TraceLog::flush(void)
+{
+#if TRACE_RECORD
+   uint16_t dropped;
+
+   noInterrupts();
+   dropped = lost;
+   lost = 0;
+   interrupts();
+
+   if (dropped) {
+      TraceRecord record = { TRACE_LOST, 0, dropped, (uint32_t) micros() };
+      Serial.write((const uint8_t *) &record, sizeof(record));
+   }
+
+   while (tail != head) {
+      Serial.write((const uint8_t *) &ring[tail], sizeof(TraceRecord));
+      tail = (tail + 1) & (TRACE_RING - 1);
+   }
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ * Host (Linux) stand-in for the Adafruit NeoPixel library
+ *
+ * show() latches the pixel colors where the simulator can see them, and
+ *    costs the 1.25us per bit of the 800kHz strip on the virtual clock
+ *    with interrupts disabled, like the real bit-banged write.
+ */
+
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+
+#define NEO_GRB     ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGB     ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_KHZ800  0x0000
+#define NEO_KHZ400  0x0100
+
+class Adafruit_NeoPixel
+{
+   public:
+      Adafruit_NeoPixel(uint16_t n, uint8_t p = 6, uint16_t t = NEO_GRB + NEO_KHZ800);
+      ~Adafruit_NeoPixel();
+
+      void     begin(void);
+      void     show(void);
+      void     setPixelColor(uint16_t n, uint32_t c);
+      void     setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+      void     setBrightness(uint8_t b) { brightness = b; }
+      void     clear(void);
+      uint32_t getPixelColor(uint16_t n) const;
+      uint16_t numPixels(void) const { return numLEDs; }
+
+      static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+         return ((uint32_t) r << 16) | ((uint32_t) g << 8) | b;
+      }
+
+   private:
+      uint16_t  numLEDs;
+      uint8_t   pin;
+      uint8_t   brightness;
+      uint32_t *pixels;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Host (Linux) stand-in for the Arduino core
+ *
+ * Just enough of the UNO core, avr-libc and the ATmega328 registers to
+ *    compile the unchanged ArenaControl sketch on the host. Time is a
+ *    virtual clock that only moves when the sketch waits (delay, I2C,
+ *    serial, NeoPixel writes) or when the simulator advances it between
+ *    loop() calls, and pin changes scripted by the simulator are
+ *    delivered to the sketch interrupt handlers as the clock passes
+ *    them. See HostCore.h for the simulator side.
+ *
+ * Types follow the host ABI (int is 32 bits, long is 64), which the
+ *    sketch does not depend on.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "Print.h"
+
+#define ARDUINO        10800
+
+#define HIGH           1
+#define LOW            0
+
+#define INPUT          0x0
+#define OUTPUT         0x1
+#define INPUT_PULLUP   0x2
+
+#define CHANGE         1
+#define FALLING        2
+#define RISING         3
+
+#define DEC            10
+#define HEX            16
+#define OCT            8
+#define BIN            2
+
+#define A0             14
+#define A1             15
+#define A2             16
+#define A3             17
+#define A4             18
+#define A5             19
+#define NUM_DIGITAL_PINS 20
+
+#define B00000001      1
+#define B00000010      2
+#define B00000100      4
+
+#define bit(b)               (1UL << (b))
+#define bitRead(value, b)    (((value) >> (b)) & 0x01)
+#define lowByte(w)           ((uint8_t) ((w) & 0xff))
+#define highByte(w)          ((uint8_t) ((w) >> 8))
+
+typedef bool     boolean;
+typedef uint8_t  byte;
+typedef uint16_t word;
+
+/* The sketch waits forever once the match is over, the simulator needs
+ *    to get control back instead once the script has no more input for
+ *    it (see ArenaControl.h)
+ */
+#define ARENA_HALT()   hostHalt()
+void hostHalt(void);
+
+/* The call into a routine marked for the pin timing trace, which the
+ *    simulator counts while it records the trace (see PinTrace.h)
+ */
+#define PIN_TRACE_ENTRY()   hostPinTraceEntry()
+void hostPinTraceEntry(void);
+
+/* The sketch's .noinit variables, in a section the simulator can find
+ *    and carry across a reset (see hostSaveBoard)
+ */
+#define ARENA_NOINIT   __attribute__((section("arena_noinit")))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+void noInterrupts(void);
+void interrupts(void);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+/* Pin change interrupt mapping, as in the UNO variant pins_arduino.h */
+#define digitalPinToPCICR(p)    (((p) <= 21) ? (&PCICR) : ((uint8_t *)0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p)    (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (((p) <= 21) ? (&PCMSK1) : ((uint8_t *)0))))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+class HardwareSerial : public Print
+{
+   public:
+      void begin(unsigned long baud);
+      void end(void);
+      int  available(void);
+      int  peek(void);
+      int  read(void);
+      int  availableForWrite(void);
+      void flush(void);
+      virtual size_t write(uint8_t c);
+      using Print::write;
+      operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
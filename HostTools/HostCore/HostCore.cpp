@@ -0,0 +1,811 @@
+/*
+ * Host (Linux) stand-in for the Arduino core - clock, pins, interrupts
+ *
+ * The UNO core functions, the ATmega328 registers the sketch touches,
+ *    the serial port, the virtual clock and interrupt delivery. The I2C
+ *    and NeoPixel devices are in HostDevices.cpp.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "Arduino.h"
+#include "MsTimer2.h"
+#include "HostCore.h"
+#include <avr/wdt.h>
+#include <avr/sleep.h>
+
+#define NEVER               (~0ULL)
+#define SERIAL_TX_BUFFER    64
+#define PORT_WRITE_CYCLES   2       // sbi/cbi
+#define TRACE_ENTRY_CYCLES  8       // call and prologue of a marked routine
+
+HostConfig hostConfig = { true, true, { 0, 0, 0, 0, 0, 0 }, false, 0, 0 };
+HostStats  hostStats;
+
+/* Registers */
+volatile uint8_t  SREG, MCUSR, WDTCSR;
+volatile uint8_t  EICRA, EIMSK, EIFR;
+volatile uint8_t  PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t  TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+volatile uint16_t OCR1A, OCR1B, ICR1;
+HostTimer1Count   TCNT1;
+HostTimer1Flags   TIFR1;
+HostPortOutput    PORTB = { 8 };
+volatile uint8_t  TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+
+/* Linker symbols the sketch uses to measure free SRAM */
+unsigned int __bss_end;
+unsigned int __heap_start;
+void *__brkval;
+
+/* Interrupt vectors the sketch may define */
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER1_OVF_vect(void) __attribute__((weak));
+extern "C" void WDT_vect(void) __attribute__((weak));
+
+/* The sketch's .noinit variables (ARENA_NOINIT), if it has any */
+extern char __start_arena_noinit[] __attribute__((weak));
+extern char __stop_arena_noinit[] __attribute__((weak));
+
+HardwareSerial Serial;
+
+static uint64_t now = 0;
+static uint64_t boot = 0;               // time of the last reset
+static bool     interruptsOn = true;
+static bool     sleepEnabled;
+static bool     sleeping;               // in sleep_cpu()
+static bool     woken;                  // an interrupt ran since sleep_enable()
+
+static uint8_t  pinModes[NUM_DIGITAL_PINS];
+static uint8_t  pinOutput[NUM_DIGITAL_PINS];
+static FILE    *pinTrace;
+static uint8_t  pinTraced[NUM_DIGITAL_PINS];   // level last written to the pin trace
+static uint8_t  pinDriven[NUM_DIGITAL_PINS] = {
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+static void   (*extHandler[2])(void);
+static int      extMode[2];
+static bool     extPending[2];
+static bool     timer2Pending;
+static uint64_t timer2Next = NEVER;
+static bool     timer1Pending;          // TOV1
+static uint64_t timer1Next = NEVER;
+static uint64_t timer1Zero;             // when the timer 1 count was last 0
+
+static void   (*msTimerFunc)(void);
+static uint64_t msTimerPeriod;
+static uint64_t msTimerNext = NEVER;
+
+static std::string serialOut;
+static std::string serialIn;
+static uint64_t    serialByteTime = 10ULL * 1000000000ULL / 9600;
+static uint64_t    serialDrained;
+
+static uint32_t randomNext = 1;
+
+/* Scheduled inputs, in time order (ties in the order they were added) */
+struct HostEvent {
+   uint64_t    at;
+   uint32_t    order;
+   uint8_t     pin;             // first pin
+   uint8_t     mask;            // pins changed, bit 0 is 'pin'
+   uint8_t     levels;
+   std::string text;            // serial input if not empty
+
+   bool operator<(const HostEvent &other) const {
+      return (at != other.at) ? (at > other.at) : (order > other.order);
+   }
+};
+
+static std::priority_queue<HostEvent> events;
+static uint32_t eventOrder;
+
+
+/*
+ * Interrupt delivery
+ */
+
+static void runIsr(void (*isr)(void))
+{
+   if (isr) {
+      interruptsOn = false;
+      isr();
+      if (hostConfig.isrCycles) {
+         uint64_t ns = (uint64_t) hostConfig.isrCycles * 1000000000ULL / F_CPU;
+         hostAdvance(ns);
+         hostStats.isrTime += ns;
+      }
+      interruptsOn = true;
+      hostStats.isrCalls++;
+      woken = true;
+   }
+}
+
+/* Run pending interrupts in vector priority order */
+static void runPending(void)
+{
+   while (interruptsOn) {
+      if (extPending[0] || extPending[1]) {
+         int n = extPending[0] ? 0 : 1;
+         extPending[n] = false;
+         runIsr(extHandler[n]);
+      } else if (PCIFR & PCICR & 0x07) {
+         int n = (PCIFR & PCICR & bit(PCIF0)) ? 0 : ((PCIFR & PCICR & bit(PCIF1)) ? 1 : 2);
+         PCIFR &= ~bit(n);
+         runIsr((0 == n) ? PCINT0_vect : ((1 == n) ? PCINT1_vect : PCINT2_vect));
+      } else if (timer2Pending) {
+         timer2Pending = false;
+         runIsr(TIMER2_COMPA_vect);
+      } else if (timer1Pending && (TIMSK1 & bit(TOIE1))) {
+         timer1Pending = false;
+         runIsr(TIMER1_OVF_vect);
+      } else {
+         break;
+      }
+   }
+}
+
+static void raise(bool &pending)
+{
+   if (!interruptsOn) {
+      hostStats.deferredIsrs += pending ? 0 : 1;
+   }
+   pending = true;
+}
+
+static uint8_t pinLevel(uint8_t pin)
+{
+   return (OUTPUT == pinModes[pin]) ? pinOutput[pin] : pinDriven[pin];
+}
+
+/* A pin's level may have changed - write it to the pin trace if it did */
+static void tracePin(uint8_t pin)
+{
+   if (pinTrace && (pinLevel(pin) != pinTraced[pin])) {
+      pinTraced[pin] = pinLevel(pin);
+      fprintf(pinTrace, "%llu %u %u\n", (unsigned long long) now, pin, pinTraced[pin]);
+   }
+}
+
+static uint64_t cyclesNs(uint32_t cycles)
+{
+   return (uint64_t) cycles * 1000000000ULL / F_CPU;
+}
+
+/* An input pin changed: external interrupt (pins 2 and 3) and pin change
+ *    interrupt flags
+ */
+static void pinChanged(uint8_t pin, uint8_t level)
+{
+   if ((2 == pin) || (3 == pin)) {
+      int n = pin - 2;
+      if (extHandler[n] && ((CHANGE == extMode[n]) ||
+                            ((RISING == extMode[n]) && level) ||
+                            ((FALLING == extMode[n]) && !level))) {
+         raise(extPending[n]);
+      }
+   }
+
+   uint8_t port = digitalPinToPCICRbit(pin);
+   if (*digitalPinToPCMSK(pin) & bit(digitalPinToPCMSKbit(pin))) {
+      if (!interruptsOn && !(PCIFR & bit(port))) {
+         hostStats.deferredIsrs++;
+      }
+      PCIFR |= bit(port);
+   }
+   runPending();
+}
+
+/* Set the levels of a scheduled change first, then raise the interrupts
+ *    for the input pins that changed
+ */
+static void drivePins(const HostEvent &event)
+{
+   uint8_t changed = 0;
+
+   for (uint8_t b=0; b < 8; b++) {
+      uint8_t pin = event.pin + b;
+      if ((event.mask & bit(b)) && (pin < NUM_DIGITAL_PINS)) {
+         uint8_t level = (event.levels >> b) & 1;
+         if (pinDriven[pin] != level) {
+            pinDriven[pin] = level;
+            changed |= (OUTPUT != pinModes[pin]) ? bit(b) : 0;
+            tracePin(pin);
+         }
+      }
+   }
+   for (uint8_t b=0; b < 8; b++) {
+      if (changed & bit(b)) {
+         pinChanged(event.pin + b, (event.levels >> b) & 1);
+      }
+   }
+}
+
+/* Timer 2 compare match period in ns, 0 if the interrupt is off (CTC
+ *    mode only, which is all the sketch uses)
+ */
+static uint64_t timer2Period(void)
+{
+   static const uint16_t prescale[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+   uint16_t divide = prescale[TCCR2B & 0x07];
+
+   if (!(TIMSK2 & bit(OCIE2A)) || (0 == divide)) {
+      return 0;
+   }
+   return ((uint64_t) (OCR2A + 1) * divide * 1000000000ULL) / F_CPU;
+}
+
+/* Timer 1 prescaler, 0 if it is stopped (or on an external clock) */
+static uint16_t timer1Divide(void)
+{
+   static const uint16_t prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+   return prescale[TCCR1B & 0x07];
+}
+
+/* Timer 1 overflow period in ns, 0 if it is stopped */
+static uint64_t timer1Period(void)
+{
+   return (65536ULL * timer1Divide() * 1000000000ULL) / F_CPU;
+}
+
+/* The count runs from its last write at the prescaled clock. The flag is
+ *    set on every overflow, and cleared by the interrupt or a write.
+ */
+HostTimer1Count::operator uint16_t() const
+{
+   uint16_t divide = timer1Divide();
+
+   if (0 == divide) {
+      return 0;
+   }
+   return (uint16_t) (((now - timer1Zero) * (F_CPU / 1000000)) / (1000ULL * divide));
+}
+
+HostTimer1Count &HostTimer1Count::operator=(uint16_t count)
+{
+   timer1Zero = now - ((uint64_t) count * timer1Divide() * 1000000000ULL) / F_CPU;
+   timer1Next = NEVER;
+   return *this;
+}
+
+HostTimer1Flags::operator uint8_t() const
+{
+   return timer1Pending ? bit(TOV1) : 0;
+}
+
+HostTimer1Flags &HostTimer1Flags::operator=(uint8_t clear)
+{
+   if (clear & bit(TOV1)) {
+      timer1Pending = false;
+   }
+   return *this;
+}
+
+/* Port B output bits, set or cleared once the write's cycles are up.
+ *    PB6 and PB7 are the crystal pins on the UNO.
+ */
+HostPortOutput &HostPortOutput::operator|=(uint8_t bits)
+{
+   if (pinTrace) {
+      hostAdvance(cyclesNs(PORT_WRITE_CYCLES));
+   }
+   for (uint8_t b=0; b < 6; b++) {
+      if (bits & bit(b)) {
+         pinOutput[firstPin + b] = HIGH;
+         tracePin(firstPin + b);
+      }
+   }
+   return *this;
+}
+
+HostPortOutput &HostPortOutput::operator&=(uint8_t bits)
+{
+   if (pinTrace) {
+      hostAdvance(cyclesNs(PORT_WRITE_CYCLES));
+   }
+   for (uint8_t b=0; b < 6; b++) {
+      if (!(bits & bit(b))) {
+         pinOutput[firstPin + b] = LOW;
+         tracePin(firstPin + b);
+      }
+   }
+   return *this;
+}
+
+
+/*
+ * Virtual clock
+ */
+
+uint64_t hostNow(void)
+{
+   return now;
+}
+
+bool hostInterruptsOn(void)
+{
+   return interruptsOn;
+}
+
+void hostRunUntil(uint64_t at)
+{
+   for (;;) {
+      if (sleeping && woken) {
+         return;
+      }
+
+      uint64_t period = timer2Period();
+      if (0 == period) {
+         timer2Next = NEVER;
+      } else if (NEVER == timer2Next) {
+         timer2Next = now + period;
+      }
+      uint64_t period1 = timer1Period();
+      if (0 == period1) {
+         timer1Next = NEVER;
+      } else if (NEVER == timer1Next) {
+         timer1Next = timer1Zero + ((now - timer1Zero) / period1 + 1) * period1;
+      }
+
+      uint64_t next = events.empty() ? NEVER : events.top().at;
+      next = std::min(next, std::min(std::min(timer2Next, timer1Next), msTimerNext));
+      if (next > at) {
+         break;
+      }
+      now = std::max(now, next);
+
+      if (next == timer2Next) {
+         timer2Next += period;
+         raise(timer2Pending);
+         runPending();
+      } else if (next == timer1Next) {
+         timer1Next += period1;
+         raise(timer1Pending);
+         runPending();
+      } else if (next == msTimerNext) {
+         msTimerNext += msTimerPeriod;
+         if (interruptsOn) {
+            interruptsOn = false;
+            msTimerFunc();
+            interruptsOn = true;
+            woken = true;
+            runPending();
+         }
+      } else {
+         HostEvent event = events.top();
+         events.pop();
+         if (!event.text.empty()) {
+            serialIn += event.text;
+         } else {
+            drivePins(event);
+         }
+      }
+   }
+   now = std::max(now, at);
+}
+
+void hostAdvance(uint64_t ns)
+{
+   hostRunUntil(now + ns);
+}
+
+/* Run the clock with interrupts disabled, anything raised meanwhile runs
+ *    at the end
+ */
+void hostBlackout(uint64_t ns)
+{
+   bool wasOn = interruptsOn;
+
+   interruptsOn = false;
+   hostAdvance(ns);
+   hostStats.blackoutTime += ns;
+   interruptsOn = wasOn;
+   runPending();
+}
+
+void hostDrivePin(uint64_t at, uint8_t pin, uint8_t level)
+{
+   hostDrivePins(at, pin, 1, level ? 1 : 0);
+}
+
+void hostDrivePins(uint64_t at, uint8_t firstPin, uint8_t mask, uint8_t levels)
+{
+   HostEvent event = { at, eventOrder++, firstPin, mask, levels, "" };
+   events.push(event);
+}
+
+void hostSetPins(uint8_t firstPin, uint8_t mask, uint8_t levels)
+{
+   for (uint8_t b=0; b < 8; b++) {
+      if ((mask & bit(b)) && (firstPin + b < NUM_DIGITAL_PINS)) {
+         pinDriven[firstPin + b] = (levels >> b) & 1;
+         tracePin(firstPin + b);
+      }
+   }
+}
+
+void hostSerialInput(uint64_t at, const char *text)
+{
+   HostEvent event = { at, eventOrder++, 0, 0, 0, text };
+   events.push(event);
+}
+
+uint64_t hostNextInput(void)
+{
+   return events.empty() ? NEVER : events.top().at;
+}
+
+/* The sketch's wait after a match - runs on to the next scheduled input
+ *    (a serial command, say), or hands control back if there is none
+ */
+void hostHalt(void)
+{
+   if (events.empty()) {
+      throw HostHalt();
+   }
+   hostRunUntil(std::max(now, events.top().at));
+}
+
+/* The watchdog runs out - its interrupt, if the sketch enabled it */
+void hostWatchdog(void)
+{
+   if ((WDTCSR & bit(WDE)) && (WDTCSR & bit(WDIE)) && interruptsOn) {
+      WDTCSR &= ~bit(WDIE);
+      runIsr(WDT_vect);
+   }
+}
+
+/* What survives a reset of the board alone: the emulated devices, and
+ *    the sketch's .noinit variables
+ */
+std::string hostSaveBoard(void)
+{
+   std::string board = hostSaveDevices();
+
+   board.append(__start_arena_noinit, __stop_arena_noinit - __start_arena_noinit);
+   return board;
+}
+
+/* Start this (freshly loaded) copy of the sketch from a reset at 'at',
+ *    with the devices and .noinit variables of the copy that was reset.
+ *    The inputs scheduled before then only set the pin levels, and the
+ *    core's clocks count from the reset.
+ */
+void hostLoadBoard(const std::string &board, uint64_t at)
+{
+   size_t devices = hostLoadDevices(board);
+   size_t noinit  = __stop_arena_noinit - __start_arena_noinit;
+
+   if (board.size() == devices + noinit) {
+      board.copy(__start_arena_noinit, noinit, devices);
+   }
+   while (!events.empty() && (events.top().at < at)) {
+      const HostEvent &event = events.top();
+      if (event.text.empty()) {
+         hostSetPins(event.pin, event.mask, event.levels);
+      }
+      events.pop();
+   }
+   now  = at;
+   boot = at;
+}
+
+const std::string &hostSerialOutput(void)
+{
+   return serialOut;
+}
+
+void hostPinTrace(FILE *out)
+{
+   pinTrace = out;
+   for (uint8_t pin=0; out && (pin < NUM_DIGITAL_PINS); pin++) {
+      pinTraced[pin] = pinLevel(pin);
+      fprintf(out, "%llu %u %u\n", (unsigned long long) now, pin, pinTraced[pin]);
+   }
+}
+
+void hostPinTraceEntry(void)
+{
+   if (pinTrace) {
+      hostAdvance(cyclesNs(TRACE_ENTRY_CYCLES));
+   }
+}
+
+uint8_t hostPinLevel(uint8_t pin)
+{
+   return (pin < NUM_DIGITAL_PINS) ? pinLevel(pin) : LOW;
+}
+
+uint8_t hostPortInput(uint8_t firstPin)
+{
+   uint8_t value = 0;
+   for (uint8_t b=0; (b < 8) && (firstPin + b < NUM_DIGITAL_PINS); b++) {
+      value |= pinLevel(firstPin + b) << b;
+   }
+   return value;
+}
+
+
+/*
+ * Arduino core
+ */
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+   if (pin < NUM_DIGITAL_PINS) {
+      pinModes[pin] = mode;
+      tracePin(pin);
+   }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+   if (pin < NUM_DIGITAL_PINS) {
+      pinOutput[pin] = val ? HIGH : LOW;
+      tracePin(pin);
+   }
+}
+
+int digitalRead(uint8_t pin)
+{
+   return (pin < NUM_DIGITAL_PINS) ? pinLevel(pin) : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+   if (pin >= A0) {
+      pin -= A0;
+   }
+   return (pin < 6) ? hostConfig.analogValue[pin] : 0;
+}
+
+/* Timer 0 overflows every 1024us, millis() counts 1 per overflow plus
+ *    1 more each time the 24us remainders add up to a whole millisecond,
+ *    and micros() has the 4us resolution of the timer 0 count
+ */
+unsigned long millis(void)
+{
+   uint64_t overflows = (now - boot) / 1024000ULL;
+   return (uint32_t) ((overflows * 128) / 125);
+}
+
+unsigned long micros(void)
+{
+   return (uint32_t) ((((now - boot) / 1000) & ~3ULL) + hostConfig.microsOffset);
+}
+
+void delay(unsigned long ms)
+{
+   hostAdvance(HOST_MS(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+   hostAdvance(HOST_US(us));
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+   if (interruptNum < 2) {
+      extHandler[interruptNum] = userFunc;
+      extMode[interruptNum] = mode;
+   }
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+   if (interruptNum < 2) {
+      extHandler[interruptNum] = NULL;
+      extPending[interruptNum] = false;
+   }
+}
+
+void noInterrupts(void)
+{
+   interruptsOn = false;
+}
+
+void interrupts(void)
+{
+   interruptsOn = true;
+   runPending();
+}
+
+/* The avr-libc random() generator, so a seed picks the same relay and
+ *    turn patterns as on the arena
+ */
+static uint32_t doRandom(uint32_t *ctx)
+{
+   int32_t hi, lo, x;
+
+   x = *ctx;
+   if (x == 0) {
+      x = 123459876L;
+   }
+   hi = x / 127773L;
+   lo = x % 127773L;
+   x = 16807L * lo - 2836L * hi;
+   if (x < 0) {
+      x += 0x7fffffffL;
+   }
+   return ((*ctx = x) % ((uint32_t) 0x7fffffffL + 1));
+}
+
+long random(long howbig)
+{
+   if (howbig == 0) {
+      return 0;
+   }
+   return (int32_t) doRandom(&randomNext) % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+   if (howsmall >= howbig) {
+      return howsmall;
+   }
+   return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+   if (seed != 0) {
+      randomNext = seed;
+   }
+}
+
+
+/*
+ * Serial port - the TX buffer drains at the baud rate, a write to a
+ *    full buffer waits for room like the real HardwareSerial
+ */
+
+void HardwareSerial::begin(unsigned long baud)
+{
+   serialByteTime = 10ULL * 1000000000ULL / baud;
+}
+
+void HardwareSerial::end(void)
+{
+}
+
+int HardwareSerial::available(void)
+{
+   return serialIn.size();
+}
+
+int HardwareSerial::peek(void)
+{
+   return serialIn.empty() ? -1 : (uint8_t) serialIn[0];
+}
+
+int HardwareSerial::read(void)
+{
+   if (serialIn.empty()) {
+      return -1;
+   }
+   uint8_t c = serialIn[0];
+   serialIn.erase(0, 1);
+   return c;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+   uint64_t queued = (serialDrained > now) ? (serialDrained - now + serialByteTime - 1) / serialByteTime : 0;
+   return (queued < SERIAL_TX_BUFFER - 1) ? (SERIAL_TX_BUFFER - 1 - queued) : 0;
+}
+
+void HardwareSerial::flush(void)
+{
+   if (serialDrained > now) {
+      hostRunUntil(serialDrained);
+   }
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+   if (serialDrained < now) {
+      serialDrained = now;
+   }
+   if (0 == availableForWrite()) {
+      uint64_t room = serialDrained - (SERIAL_TX_BUFFER - 2) * serialByteTime;
+      hostStats.serialBlocked += room - now;
+      hostRunUntil(room);
+   }
+   serialDrained += serialByteTime;
+   serialOut += (char) c;
+   hostStats.serialBytes++;
+   if (hostConfig.echoSerial) {
+      putchar(c);
+   }
+   return 1;
+}
+
+
+/*
+ * MsTimer2
+ */
+
+void MsTimer2::set(unsigned long ms, void (*f)())
+{
+   msTimerPeriod = HOST_MS(ms ? ms : 1);
+   msTimerFunc = f;
+}
+
+void MsTimer2::start()
+{
+   if (msTimerFunc) {
+      msTimerNext = now + msTimerPeriod;
+   }
+}
+
+void MsTimer2::stop()
+{
+   msTimerNext = NEVER;
+}
+
+
+/*
+ * Sleep - the CPU stops until an interrupt handler has run, or the next
+ *    timer 0 overflow. An interrupt already pending when sei() comes just
+ *    before sleep_cpu() runs in sei() here, and wakes the CPU at once as
+ *    it does on the arena (the instruction after sei always runs first).
+ */
+
+void set_sleep_mode(uint8_t mode)
+{
+}
+
+void sleep_enable(void)
+{
+   sleepEnabled = true;
+   woken = false;
+}
+
+void sleep_disable(void)
+{
+   sleepEnabled = false;
+}
+
+void sleep_cpu(void)
+{
+   if (!sleepEnabled || woken || !interruptsOn) {
+      return;
+   }
+
+   uint64_t began = now;
+   uint64_t tick  = boot + ((now - boot) / 1024000ULL + 1) * 1024000ULL;
+
+   sleeping = true;
+   hostRunUntil(tick);
+   sleeping = false;
+   hostStats.sleeps++;
+   hostStats.sleepTime += now - began;
+}
+
+
+/*
+ * Watchdog - enabling it only sets WDE, see avr/wdt.h
+ */
+
+void wdt_enable(uint8_t timeout)
+{
+   WDTCSR = bit(WDE) | (timeout & 0x07) | ((timeout & 0x08) ? 0x20 : 0);
+}
+
+void wdt_disable(void)
+{
+   WDTCSR = 0;
+}
+
+void wdt_reset(void)
+{
+}
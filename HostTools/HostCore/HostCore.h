@@ -0,0 +1,117 @@
+/*
+ * Host (Linux) stand-in for the Arduino core - simulator interface
+ *
+ * The sketch sees Arduino.h, the simulator drives the board through
+ *    this header: it configures the board, schedules input pin changes
+ *    and serial input on the virtual clock, runs the clock forward and
+ *    inspects the emulated devices.
+ *
+ * The virtual clock counts nanoseconds from reset. It only moves when
+ *    the sketch waits (delay, I2C transfers, a full serial TX buffer,
+ *    NeoPixel writes) or when the simulator runs it forward. Scheduled
+ *    pin changes take effect as the clock passes them and call the
+ *    sketch interrupt handlers enabled at the time, or set the pending
+ *    flag if interrupts are disabled, so a handler runs once when they
+ *    are enabled again whatever the number of changes in between.
+ *    hostDrivePins() changes several pins at the same instant, so the
+ *    sketch never sees a state in between.
+ *
+ * Interrupt handlers take no virtual time unless isrCycles is set, in
+ *    which case each one keeps interrupts off for that long after it
+ *    has read its inputs, and changes meanwhile wait for it to finish.
+ *    I2C transfers keep interrupts off for the TWI interrupt of each
+ *    byte, and NeoPixel writes for the whole write.
+ */
+
+#ifndef HostCore_h
+#define HostCore_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#define HOST_US(us)   ((uint64_t) (us) * 1000ULL)
+#define HOST_MS(ms)   ((uint64_t) (ms) * 1000000ULL)
+
+/* Thrown by ARENA_HALT() when the sketch would wait forever with no
+ *    input left to come
+ */
+struct HostHalt {};
+
+/* Board configuration, set before setup() is called */
+struct HostConfig {
+   bool lcdAttached;            // controller box (LCD backpack at 0x27)
+   bool relayAttached;          // stage 1 relay board (expander at 0x20)
+   int  analogValue[6];         // analogRead() result for A0-A5
+   bool echoSerial;             // copy serial output to stdout
+   long microsOffset;           // added to micros()
+   int  isrCycles;              // CPU time of an interrupt handler (0 is instant)
+};
+
+/* Counters of where the virtual time went */
+struct HostStats {
+   uint64_t isrCalls;           // interrupt handlers run
+   uint64_t isrTime;            // ns in interrupt handlers (see isrCycles)
+   uint64_t deferredIsrs;       // interrupts held pending by a blackout
+   uint64_t i2cTransfers;
+   uint64_t i2cTime;            // ns waiting on the I2C bus
+   uint64_t serialBytes;
+   uint64_t serialBlocked;      // ns waiting for room in the TX buffer
+   uint64_t pixelShows;
+   uint64_t blackoutTime;       // ns with interrupts disabled by show() and TWI
+   uint64_t eepromWrites;       // EEPROM bytes written
+   uint64_t sleeps;             // times sleep_cpu() stopped the CPU
+   uint64_t sleepTime;          // ns asleep
+};
+
+extern HostConfig hostConfig;
+extern HostStats  hostStats;
+
+/* Virtual clock */
+uint64_t hostNow(void);
+bool     hostInterruptsOn(void);
+void     hostAdvance(uint64_t ns);
+void     hostRunUntil(uint64_t at);
+void     hostBlackout(uint64_t ns);
+
+/* Scheduled inputs */
+void     hostDrivePin(uint64_t at, uint8_t pin, uint8_t level);
+void     hostDrivePins(uint64_t at, uint8_t firstPin, uint8_t mask, uint8_t levels);
+void     hostSerialInput(uint64_t at, const char *text);
+uint64_t hostNextInput(void);             // time of the next one, ~0 if none
+
+/* Input levels changed now without raising any interrupt, for benches
+ *    that call a handler directly
+ */
+void     hostSetPins(uint8_t firstPin, uint8_t mask, uint8_t levels);
+
+/* Emulated devices and pins */
+const std::string &hostSerialOutput(void);
+std::string hostLcdLine(uint8_t row);
+uint16_t hostRelays(void);
+uint32_t hostPixel(uint16_t n);
+uint8_t  hostPinLevel(uint8_t pin);
+uint8_t *hostEeprom(void);
+
+/* Pin timing trace: from now on, write "<ns> <pin> <level>" to out for
+ *    every change of a pin's level, starting with the level of every
+ *    pin, or stop if out is NULL. While it is on, each port B write
+ *    takes the 2 cycles of its sbi/cbi and each marked routine the
+ *    cycles of the call into it, so the windows of a PIN_TRACE build
+ *    (see PinTrace.h) come out about as wide as on the arena.
+ */
+void        hostPinTrace(FILE *out);
+
+/* A reset of the board alone (the watchdog, say), as the arena sees it:
+ *    the devices keep their state and the sketch's .noinit variables
+ *    their contents. The simulator saves the board from the copy of the
+ *    sketch being reset and loads it into a fresh copy (a forked child
+ *    that has not run setup()) - see arenasim.
+ */
+void        hostWatchdog(void);
+std::string hostSaveBoard(void);
+void        hostLoadBoard(const std::string &board, uint64_t at);
+std::string hostSaveDevices(void);
+size_t      hostLoadDevices(const std::string &board);
+
+#endif
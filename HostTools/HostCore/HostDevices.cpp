@@ -0,0 +1,363 @@
+/*
+ * Host (Linux) stand-in for the Arduino core - emulated devices
+ *
+ * The I2C bus with the two arena devices on it, and the NeoPixel stick:
+ *
+ *    0x20  PCF8575 16 bit expander driving the stage 1 relay board. The
+ *          sketch writes the inverted relay mask, low byte first.
+ *    0x27  PCF8574 backpack driving a 4x20 HD44780 LCD in 4 bit mode
+ *          (P0 RS, P1 RW, P2 EN, P3 backlight, P4-P7 data). A nibble is
+ *          latched on the falling edge of EN.
+ *
+ * and the EEPROM.
+ */
+
+#include <string.h>
+#include <avr/eeprom.h>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "Adafruit_NeoPixel.h"
+#include "HostCore.h"
+
+#define I2C_ADDR_RELAY   0x20
+#define I2C_ADDR_LCD     0x27
+
+#define I2C_BIT_NS       10000ULL       // 100kHz
+#define I2C_OVERHEAD_NS  20000ULL       // start, stop and library time
+#define I2C_ISR_NS       8000ULL        // TWI interrupt per byte
+
+#define EEPROM_WRITE_NS  3400000ULL     // erase and write of one byte
+
+#define LCD_EN           0x04
+#define LCD_RS           0x01
+
+TwoWire Wire;
+
+static uint16_t relays;
+
+static uint8_t  lcdExpander;
+static bool     lcdFourBit;
+static bool     lcdHighNibble = true;
+static uint8_t  lcdByte;
+static uint8_t  lcdAddress;
+static char     lcdRam[128];
+
+static uint8_t  eeprom[E2END + 1];
+static struct EepromErase {
+   EepromErase() { memset(eeprom, 0xFF, sizeof(eeprom)); }
+} eepromErase;
+
+
+/*
+ * HD44780
+ */
+
+static void lcdClear(void)
+{
+   memset(lcdRam, ' ', sizeof(lcdRam));
+   lcdAddress = 0;
+}
+
+static void lcdCommand(uint8_t value)
+{
+   if (value & 0x80) {
+      lcdAddress = value & 0x7F;
+   } else if (value & 0x20) {
+      lcdFourBit = !(value & 0x10);
+   } else if (value & 0x02) {
+      lcdAddress = 0;
+   } else if (value & 0x01) {
+      lcdClear();
+   }
+}
+
+static void lcdNibble(uint8_t expander)
+{
+   uint8_t nibble = expander & 0xF0;
+
+   /* Until the controller is in 4 bit mode, the data lines D4-D7 are a
+    *    whole command with D0-D3 low
+    */
+   if (!lcdFourBit) {
+      lcdCommand(nibble);
+      lcdHighNibble = true;
+      return;
+   }
+   if (lcdHighNibble) {
+      lcdByte = nibble;
+      lcdHighNibble = false;
+      return;
+   }
+   lcdByte |= nibble >> 4;
+   lcdHighNibble = true;
+   if (expander & LCD_RS) {
+      lcdRam[lcdAddress] = lcdByte;
+      lcdAddress = (lcdAddress + 1) & 0x7F;
+   } else {
+      lcdCommand(lcdByte);
+   }
+}
+
+static void lcdExpanderWrite(uint8_t value)
+{
+   if ((lcdExpander & LCD_EN) && !(value & LCD_EN)) {
+      lcdNibble(value);
+   }
+   lcdExpander = value;
+}
+
+/* Rows of a 4x20 display in the 2 line DDRAM layout */
+std::string hostLcdLine(uint8_t row)
+{
+   static const uint8_t rowStart[4] = { 0x00, 0x40, 0x14, 0x54 };
+
+   if (0 == lcdRam[0]) {
+      lcdClear();
+   }
+   return std::string(&lcdRam[rowStart[row & 3]], 20);
+}
+
+uint16_t hostRelays(void)
+{
+   return relays;
+}
+
+
+/*
+ * Wire
+ */
+
+void TwoWire::begin(void)
+{
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+   this->address = address;
+   length = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+   if (length >= BUFFER_LENGTH) {
+      return 0;
+   }
+   buffer[length++] = data;
+   return 1;
+}
+
+uint8_t TwoWire::endTransmission(void)
+{
+   bool ack = ((I2C_ADDR_RELAY == address) && hostConfig.relayAttached) ||
+              ((I2C_ADDR_LCD   == address) && hostConfig.lcdAttached);
+
+   /* Address byte, then the data if the device answered, 9 clocks each
+    *    and the TWI interrupt that loads the next one
+    */
+   uint8_t  bytes = 1 + (ack ? length : 0);
+   uint64_t start = hostNow();
+
+   hostAdvance(I2C_OVERHEAD_NS);
+   for (uint8_t b=0; b < bytes; b++) {
+      hostAdvance(9 * I2C_BIT_NS - I2C_ISR_NS);
+      hostBlackout(I2C_ISR_NS);
+   }
+   hostStats.i2cTransfers++;
+   hostStats.i2cTime += hostNow() - start;
+
+   if (!ack) {
+      return 2;
+   }
+   if (I2C_ADDR_RELAY == address) {
+      if (length >= 2) {
+         relays = ~(buffer[length-2] | (buffer[length-1] << 8));
+      }
+   } else {
+      for (uint8_t i=0; i < length; i++) {
+         lcdExpanderWrite(buffer[i]);
+      }
+   }
+   return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+   return 0;
+}
+
+int TwoWire::available(void)
+{
+   return 0;
+}
+
+int TwoWire::read(void)
+{
+   return -1;
+}
+
+
+/*
+ * NeoPixel - 24 bits per pixel at 1.25us per bit, and the 50us latch
+ *    time the library waits for before the next write
+ */
+
+#define NEO_BIT_NS     1250ULL
+#define NEO_LATCH_NS   50000ULL
+
+static uint32_t *shownPixels;
+static uint16_t  shownCount;
+static uint64_t  showEnd;
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint16_t t)
+   : numLEDs(n), pin(p), brightness(0), pixels(new uint32_t[n]())
+{
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+   delete[] pixels;
+}
+
+void Adafruit_NeoPixel::begin(void)
+{
+   pinMode(pin, OUTPUT);
+   digitalWrite(pin, LOW);
+}
+
+void Adafruit_NeoPixel::show(void)
+{
+   if (hostNow() < showEnd + NEO_LATCH_NS) {
+      hostRunUntil(showEnd + NEO_LATCH_NS);
+   }
+   hostBlackout(numLEDs * 24 * NEO_BIT_NS);
+   showEnd = hostNow();
+   shownPixels = pixels;
+   shownCount = numLEDs;
+   hostStats.pixelShows++;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c)
+{
+   if (n < numLEDs) {
+      pixels[n] = c;
+   }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+   setPixelColor(n, Color(r, g, b));
+}
+
+void Adafruit_NeoPixel::clear(void)
+{
+   memset(pixels, 0, numLEDs * sizeof(pixels[0]));
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const
+{
+   return (n < numLEDs) ? pixels[n] : 0;
+}
+
+/* Colors as of the last show() */
+uint32_t hostPixel(uint16_t n)
+{
+   return (n < shownCount) ? shownPixels[n] : 0;
+}
+
+
+/*
+ * EEPROM - addresses outside it wrap, as the address register does
+ */
+uint8_t eeprom_read_byte(const uint8_t *address)
+{
+   return eeprom[(uintptr_t) address & E2END];
+}
+
+void eeprom_read_block(void *data, const void *address, size_t length)
+{
+   for (size_t n=0; n < length; n++) {
+      ((uint8_t *) data)[n] = eeprom_read_byte((const uint8_t *) address + n);
+   }
+}
+
+void eeprom_write_byte(uint8_t *address, uint8_t value)
+{
+   eeprom[(uintptr_t) address & E2END] = value;
+   hostStats.eepromWrites++;
+   hostAdvance(EEPROM_WRITE_NS);
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+   if (eeprom_read_byte(address) != value) {
+      eeprom_write_byte(address, value);
+   }
+}
+
+void eeprom_update_block(const void *data, void *address, size_t length)
+{
+   for (size_t n=0; n < length; n++) {
+      eeprom_update_byte((uint8_t *) address + n, ((const uint8_t *) data)[n]);
+   }
+}
+
+uint8_t *hostEeprom(void)
+{
+   return eeprom;
+}
+
+
+/*
+ * Reset of the board alone - the devices keep their state
+ */
+
+struct DeviceState {
+   uint16_t relays;
+   uint8_t  lcdExpander;
+   bool     lcdFourBit;
+   bool     lcdHighNibble;
+   uint8_t  lcdByte;
+   uint8_t  lcdAddress;
+   char     lcdRam[128];
+   uint8_t  eeprom[E2END + 1];
+};
+
+std::string hostSaveDevices(void)
+{
+   DeviceState state;
+
+   state.relays        = relays;
+   state.lcdExpander   = lcdExpander;
+   state.lcdFourBit    = lcdFourBit;
+   state.lcdHighNibble = lcdHighNibble;
+   state.lcdByte       = lcdByte;
+   state.lcdAddress    = lcdAddress;
+   memcpy(state.lcdRam, lcdRam, sizeof(lcdRam));
+   memcpy(state.eeprom, eeprom, sizeof(eeprom));
+   return std::string((const char *) &state, sizeof(state));
+}
+
+/* Bytes of the board used by the devices */
+size_t hostLoadDevices(const std::string &board)
+{
+   DeviceState state;
+
+   if (board.size() < sizeof(state)) {
+      return board.size();
+   }
+   board.copy((char *) &state, sizeof(state));
+   relays        = state.relays;
+   lcdExpander   = state.lcdExpander;
+   lcdFourBit    = state.lcdFourBit;
+   lcdHighNibble = state.lcdHighNibble;
+   lcdByte       = state.lcdByte;
+   lcdAddress    = state.lcdAddress;
+   memcpy(lcdRam, state.lcdRam, sizeof(lcdRam));
+   memcpy(eeprom, state.eeprom, sizeof(eeprom));
+   return sizeof(state);
+}
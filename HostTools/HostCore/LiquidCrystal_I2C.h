@@ -0,0 +1,13 @@
+/*
+ * Host (Linux) stand-in for the LiquidCrystal_I2C library
+ *
+ * The sketch includes this header but drives the LCD through its own
+ *    Sainsmart_I2CLCD class, so nothing is needed here
+ */
+
+#ifndef LiquidCrystal_I2C_h
+#define LiquidCrystal_I2C_h
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Host (Linux) stand-in for the MsTimer2 library
+ *
+ * The callback runs from the virtual clock every 'ms' milliseconds
+ */
+
+#ifndef MsTimer2_h
+#define MsTimer2_h
+
+#include "Arduino.h"
+
+namespace MsTimer2 {
+   void set(unsigned long ms, void (*f)());
+   void start();
+   void stop();
+}
+
+#endif
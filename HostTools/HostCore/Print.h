@@ -0,0 +1,75 @@
+/*
+ * Host (Linux) stand-in for the Arduino core - Print and String
+ *
+ * Same formatting as the Arduino Print class, so serial logs from the
+ *    simulator match the ones from the arena byte for byte. String only
+ *    covers the constructors the sketch uses to print numbers and text.
+ */
+
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String
+{
+   public:
+      String(const char *cstr = "") : text(cstr ? cstr : "") {}
+      explicit String(char c) : text(1, c) {}
+      explicit String(unsigned char value, unsigned char base = 10) { number((unsigned long) value, base); }
+      explicit String(int value, unsigned char base = 10) { number((long) value, base); }
+      explicit String(unsigned int value, unsigned char base = 10) { number((unsigned long) value, base); }
+      explicit String(long value, unsigned char base = 10) { number(value, base); }
+      explicit String(unsigned long value, unsigned char base = 10) { number(value, base); }
+
+      const char *c_str() const { return text.c_str(); }
+      unsigned int length() const { return text.length(); }
+
+   private:
+      void number(long value, unsigned char base);
+      void number(unsigned long value, unsigned char base);
+      std::string text;
+};
+
+class Print
+{
+   public:
+      virtual ~Print() {}
+      virtual size_t write(uint8_t c) = 0;
+      size_t write(const char *str);
+      virtual size_t write(const uint8_t *buffer, size_t size);
+
+      size_t print(const __FlashStringHelper *ifsh);
+      size_t print(const String &s);
+      size_t print(const char str[]);
+      size_t print(char c);
+      size_t print(unsigned char n, int base = 10);
+      size_t print(int n, int base = 10);
+      size_t print(unsigned int n, int base = 10);
+      size_t print(long n, int base = 10);
+      size_t print(unsigned long n, int base = 10);
+      size_t print(double n, int digits = 2);
+
+      size_t println(const __FlashStringHelper *ifsh);
+      size_t println(const String &s);
+      size_t println(const char str[]);
+      size_t println(char c);
+      size_t println(unsigned char n, int base = 10);
+      size_t println(int n, int base = 10);
+      size_t println(unsigned int n, int base = 10);
+      size_t println(long n, int base = 10);
+      size_t println(unsigned long n, int base = 10);
+      size_t println(double n, int digits = 2);
+      size_t println(void);
+
+   private:
+      size_t printNumber(unsigned long n, uint8_t base);
+      size_t printFloat(double number, uint8_t digits);
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Host (Linux) stand-in for the Arduino Wire (I2C master) library
+ *
+ * Transmissions go to the emulated devices in HostCore.cpp - the relay
+ *    board expander and the LCD backpack - and cost the bus time of a
+ *    100kHz transfer on the virtual clock. A transmission to any other
+ *    address is not acknowledged.
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire : public Print
+{
+   public:
+      void    begin(void);
+      void    setClock(uint32_t clock);
+      void    beginTransmission(uint8_t address);
+      void    beginTransmission(int address) { beginTransmission((uint8_t) address); }
+      uint8_t endTransmission(void);
+      uint8_t requestFrom(uint8_t address, uint8_t quantity);
+      virtual size_t write(uint8_t data);
+      using Print::write;
+      int     available(void);
+      int     read(void);
+
+   private:
+      uint8_t address;
+      uint8_t buffer[BUFFER_LENGTH];
+      uint8_t length;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host (Linux) stand-in for avr-libc - EEPROM
+ *
+ * The ATmega328's 1 KB EEPROM, erased (all 0xFF) at reset. Each byte
+ *    written takes its 3.4ms of virtual time, as the real write does.
+ */
+
+#ifndef _AVR_EEPROM_H_
+#define _AVR_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define E2END     0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t *address);
+void    eeprom_read_block(void *data, const void *address, size_t length);
+void    eeprom_write_byte(uint8_t *address, uint8_t value);
+void    eeprom_update_byte(uint8_t *address, uint8_t value);
+void    eeprom_update_block(const void *data, void *address, size_t length);
+
+#endif
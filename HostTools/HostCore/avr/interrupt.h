@@ -0,0 +1,19 @@
+/*
+ * Host (Linux) stand-in for avr-libc - interrupts
+ *
+ * An ISR is a plain C function named after its vector, called by the
+ *    simulator when the emulated peripheral raises the interrupt
+ */
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#define ISR(vector, ...)   extern "C" void vector(void)
+
+#define cli()              noInterrupts()
+#define sei()              interrupts()
+
+void noInterrupts(void);
+void interrupts(void);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Host (Linux) stand-in for avr-libc - ATmega328 registers
+ *
+ * Control registers are plain variables that the simulator inspects
+ *    to decide which emulated interrupts are enabled. The input port
+ *    registers read the emulated pin levels, port B output drives them,
+ *    and the timer 1 count and overflow flag follow the virtual clock.
+ */
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#define F_CPU     16000000UL
+
+#define _BV(bit)  (1 << (bit))
+
+uint8_t hostPortInput(uint8_t firstPin);
+
+#define PIND      hostPortInput(0)
+#define PINB      hostPortInput(8)
+#define PINC      hostPortInput(14)
+
+/* Port B output - the single bit sets and clears (sbi/cbi) of the pin
+ *    timing trace are all the sketch writes to it (see PinTrace.h)
+ */
+struct HostPortOutput {
+   uint8_t firstPin;
+
+   HostPortOutput &operator|=(uint8_t bits);
+   HostPortOutput &operator&=(uint8_t bits);
+};
+
+extern HostPortOutput PORTB;
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t MCUSR;
+
+#define PORF      0
+#define EXTRF     1
+#define BORF      2
+#define WDRF      3
+
+/* Watchdog (see avr/wdt.h) */
+extern volatile uint8_t WDTCSR;
+
+#define WDE       3
+#define WDIE      6
+
+/* External and pin change interrupts */
+extern volatile uint8_t EICRA, EIMSK, EIFR;
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+
+#define PCIE0     0
+#define PCIE1     1
+#define PCIE2     2
+#define PCIF0     0
+#define PCIF1     1
+#define PCIF2     2
+
+/* Timer 1 (16 bit) - normal mode only. Writing a 1 to a TIFR1 bit
+ *    clears it, as on the chip.
+ */
+struct HostTimer1Count {
+   operator uint16_t() const;
+   HostTimer1Count &operator=(uint16_t count);
+};
+
+struct HostTimer1Flags {
+   operator uint8_t() const;
+   HostTimer1Flags &operator=(uint8_t clear);
+};
+
+extern volatile uint8_t  TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+extern volatile uint16_t OCR1A, OCR1B, ICR1;
+extern HostTimer1Count   TCNT1;
+extern HostTimer1Flags   TIFR1;
+
+#define CS10      0
+#define CS11      1
+#define CS12      2
+#define TOIE1     0
+#define TOV1      0
+
+/* Timer 2 (8 bit) */
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+
+#define WGM20     0
+#define WGM21     1
+#define WGM22     3
+#define CS20      0
+#define CS21      1
+#define CS22      2
+#define TOIE2     0
+#define OCIE2A    1
+#define OCIE2B    2
+#define TOV2      0
+#define OCF2A     1
+#define OCF2B     2
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host (Linux) stand-in for avr-libc - sleep modes
+ *
+ * Only SLEEP_MODE_IDLE: sleep_cpu() runs the virtual clock on until an
+ *    interrupt handler has run, or timer 0 overflows - it is not
+ *    otherwise modelled as an interrupt (see millis()), but wakes an
+ *    idle CPU every 1.024ms on the arena.
+ */
+
+#ifndef _AVR_SLEEP_H_
+#define _AVR_SLEEP_H_
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE   0
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+
+#endif
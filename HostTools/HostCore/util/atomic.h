@@ -0,0 +1,33 @@
+/*
+ * Host (Linux) stand-in for avr-libc - atomic blocks
+ *
+ * ATOMIC_BLOCK runs its body once with interrupts off. The restore
+ *    state is the only type the sketch uses: interrupts are back on
+ *    afterwards only if they were on before, so it is safe in an ISR.
+ */
+
+#ifndef _UTIL_ATOMIC_H_
+#define _UTIL_ATOMIC_H_
+
+bool hostInterruptsOn(void);
+void noInterrupts(void);
+void interrupts(void);
+
+struct HostAtomic {
+   bool wasOn;
+
+   HostAtomic() : wasOn(hostInterruptsOn()) {
+      noInterrupts();
+   }
+   ~HostAtomic() {
+      if (wasOn) {
+         interrupts();
+      }
+   }
+};
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) \
+   for (HostAtomic hostAtomic, *hostOnce = &hostAtomic; hostOnce; hostOnce = 0)
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Host model of the arena quadrature decoder
+ *
+ * Synthetic quadrature waveforms (with jitter and contact bounce) and
+ *    timing models of the two decoding modes in Quadrature.cpp - the 
+ *    edge triggered PCINT2 interrupt and the timer sampled interrupt.
+ *    Both run the real state change table from QuadratureTable.h, so
+ *    only the interrupt timing is modelled.
+ */
+
+#ifndef QuadModel_h
+#define QuadModel_h
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "QuadratureTable.h"
+
+#define CPU_MHZ          16.0
+
+/* ISR costs in cycles (see the budget in Quadrature.cpp). The pins are
+ *    read after the interrupt response and prologue.
+ */
+#define ISR_READ_CYCLES  26
+#define ISR_CYCLES       115    // edge mode worst case, ~111 for a sample with motion
+#define ISR_IDLE_CYCLES  75     // sampled mode, sample with no motion
+
+/* A change of pin state at a time (microseconds), A in bit 0, B in bit 1 */
+struct PinEdge {
+   double  t;
+   uint8_t pins;
+};
+
+struct Waveform {
+   std::vector<PinEdge> edges;
+   long   truePosition;        // final position, in counts
+   long   transitions;         // real (non-bounce) transitions
+   double duration;            // microseconds
+};
+
+struct DecodeResult {
+   long   position;            // final decoded position
+   long   isrRuns;             // number of ISR executions
+   double busy;                // microseconds spent in the ISR
+};
+
+static double uniform(void)
+{
+   return rand() / (RAND_MAX + 1.0);
+}
+
+/* Clockwise order of the pin states (A in bit 0, B in bit 1) for which
+ *    the state change table counts +1 per transition
+ */
+static const uint8_t clockwiseOrder[4] = { 3, 1, 0, 2 };
+
+/* Generate 'transitions' quadrature transitions at 'rate' per second,
+ *    with +/- 'jitter' (fraction of the period) on each transition time.
+ *    Each real transition is followed by 'bounces' pairs of extra toggles
+ *    of the same channel inside 'bounceWindow' microseconds, which may
+ *    run past the next transition. The knob reverses direction with
+ *    probability 'reverse' at each transition.
+ */
+static Waveform makeWaveform(long transitions, double rate, double jitter,
+                             int bounces, double bounceWindow, double reverse)
+{
+   Waveform wave;
+   double   period = 1e6 / rate;
+   int      phase = 0;
+   int      direction = 1;
+   uint8_t  pins = clockwiseOrder[0];
+   double   t = period;
+
+   wave.truePosition = 0;
+   wave.transitions  = transitions;
+
+   for (long n=0; n < transitions; n++) {
+      double when = t + (uniform() - 0.5) * 2.0 * jitter * period;
+      uint8_t next, changed;
+
+      if (uniform() < reverse) {
+         direction = -direction;
+      }
+      phase = (phase + direction + 4) % 4;
+      next = clockwiseOrder[phase];
+      changed = pins ^ next;
+      wave.truePosition += direction;
+
+      /* Each edge holds the channel it toggles until they are sorted */
+      wave.edges.push_back((PinEdge) { when, changed });
+      for (int b=0; b < bounces; b++) {
+         double t1 = when + uniform() * bounceWindow;
+         double t2 = t1 + uniform() * (bounceWindow - (t1 - when));
+         wave.edges.push_back((PinEdge) { t1, changed });
+         wave.edges.push_back((PinEdge) { t2, changed });
+      }
+      pins = next;
+      t += period;
+   }
+
+   /* Bounce toggles of one transition can interleave with each other and
+    *    with later transitions, so sort by time and rebuild the pin state
+    *    as a sequence of toggles - each bounce pair cancels out whatever
+    *    lands between its two toggles
+    */
+   std::stable_sort(wave.edges.begin(), wave.edges.end(),
+                    [](const PinEdge &a, const PinEdge &b) { return a.t < b.t; });
+   pins = clockwiseOrder[0];
+   for (size_t e=0; e < wave.edges.size(); e++) {
+      pins ^= wave.edges[e].pins;
+      wave.edges[e].pins = pins;
+   }
+   wave.duration = t;
+   return wave;
+}
+
+/* Pin state at time t */
+static uint8_t pinsAt(const Waveform &wave, double t)
+{
+   std::vector<PinEdge>::const_iterator it =
+      std::upper_bound(wave.edges.begin(), wave.edges.end(), t,
+                       [](double v, const PinEdge &e) { return v < e.t; });
+   return (it == wave.edges.begin()) ? clockwiseOrder[0] : (it-1)->pins;
+}
+
+/* Blackout windows (interrupts disabled by the foreground) as sorted,
+ *    non-overlapping [start, end) pairs in microseconds
+ */
+typedef std::vector<std::pair<double,double> > Blackouts;
+
+/* Earliest time at or after t when interrupts are enabled */
+static double interruptsEnabled(const Blackouts &blackouts, size_t &cursor, double t)
+{
+   while ((cursor < blackouts.size()) && (blackouts[cursor].second <= t)) {
+      cursor++;
+   }
+   if ((cursor < blackouts.size()) && (blackouts[cursor].first <= t)) {
+      return blackouts[cursor].second;
+   }
+   return t;
+}
+
+/* Edge triggered mode: every edge sets the PCINT2 flag. The flag is
+ *    cleared when the vector is entered, so an edge during the ISR causes
+ *    one more run after it, and any number of edges while the ISR is
+ *    pending or blacked out collapse into a single run.
+ */
+static inline DecodeResult decodeEdge(const Waveform &wave, const Blackouts &blackouts = Blackouts())
+{
+   DecodeResult result = { 0, 0, 0.0 };
+   uint8_t state = clockwiseOrder[0] << 2;     // old pins in bits 2,3
+   size_t  cursor = 0;
+   size_t  next = 0;
+   double  free = 0.0;            // time the CPU can next enter the ISR
+
+   while (next < wave.edges.size()) {
+      double entry = std::max(wave.edges[next].t, free);
+      entry = interruptsEnabled(blackouts, cursor, entry);
+
+      double read = entry + ISR_READ_CYCLES / CPU_MHZ;
+      result.position += quadratureStep(state, pinsAt(wave, read));
+      result.isrRuns++;
+      result.busy += ISR_CYCLES / CPU_MHZ;
+      free = entry + ISR_CYCLES / CPU_MHZ;
+
+      /* skip edges that landed before the flag was cleared on entry */
+      while ((next < wave.edges.size()) && (wave.edges[next].t <= entry)) {
+         next++;
+      }
+   }
+   return result;
+}
+
+/* Timer sampled mode: sample at a fixed rate, a sample that falls in a
+ *    blackout is taken as soon as interrupts are enabled again
+ */
+static inline DecodeResult decodeSampled(const Waveform &wave, double sampleHz,
+                                  const Blackouts &blackouts = Blackouts())
+{
+   DecodeResult result = { 0, 0, 0.0 };
+   uint8_t state = clockwiseOrder[0] << 2;     // old pins in bits 2,3
+   size_t  cursor = 0;
+   double  period = 1e6 / sampleHz;
+   double  end = wave.duration + period;
+
+   for (double t=period; t < end; t += period) {
+      double entry = interruptsEnabled(blackouts, cursor, t);
+      int8_t change = quadratureStep(state, pinsAt(wave, entry + ISR_READ_CYCLES / CPU_MHZ));
+
+      result.position += change;
+      result.isrRuns++;
+      result.busy += (change ? ISR_CYCLES : ISR_IDLE_CYCLES) / CPU_MHZ;
+   }
+   return result;
+}
+
+#endif
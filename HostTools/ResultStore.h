@@ -0,0 +1,195 @@
+/*
+ * Columnar store of match results
+ *
+ * The match results in the arena serial reports, as typed columns for
+ *    arenaingest to append to and arenaquery to aggregate over. A store
+ *    is one file of blocks, and each block holds a run of matches one
+ *    column after the other:
+ *
+ *    StoreBlock header, then for each column in the order of the schema
+ *    below, 'rows' values of the column's width
+ *
+ *    Numbers are signed little endian integers of their width, text is
+ *    NUL padded to its width. A query maps the file and reads only the
+ *    columns it uses, so nothing is parsed again. Blocks are only ever
+ *    appended (under flock, so several ingesters can share a store), and
+ *    a partly written last block is ignored.
+ */
+
+#ifndef ResultStore_h
+#define ResultStore_h
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define STORE_MAGIC      "ARS2"
+#define STORE_NO_VALUE   -1          // a number the report did not have
+
+enum ColumnType { COLUMN_NUMBER, COLUMN_TEXT };
+
+struct ColumnInfo {
+   const char *name;
+   ColumnType  type;
+   uint8_t     width;               // bytes per value
+   const char *about;
+};
+
+/* The schema - add columns at the end, and change STORE_MAGIC */
+enum Column {
+   COL_ARENA, COL_OFFSET, COL_INGESTED, COL_SEED, COL_SCORE, COL_STAGE2,
+   COL_STAGE3, COL_RELAY, COL_TURNS, COL_SABER, COL_HITS, COL_DIGITS,
+   COL_RUNTIME, COLUMNS
+};
+
+static const ColumnInfo columnInfo[COLUMNS] = {
+   { "arena",    COLUMN_TEXT,   16, "capture the match was read from" },
+   { "offset",   COLUMN_NUMBER, 8,  "end of the match in the capture, bytes" },
+   { "ingested", COLUMN_NUMBER, 4,  "time ingested, unix seconds" },
+   { "seed",     COLUMN_NUMBER, 2,  "RANDOM SEED" },
+   { "score",    COLUMN_NUMBER, 2,  "FINAL SCORE" },
+   { "stage2",   COLUMN_NUMBER, 2,  "stage 2 STAGE SCORE" },
+   { "stage3",   COLUMN_NUMBER, 2,  "stage 3 STAGE SCORE" },
+   { "relay",    COLUMN_NUMBER, 1,  "RELAY INDEX" },
+   { "turns",    COLUMN_NUMBER, 4,  "stage 3 combination of the relay index" },
+   { "saber",    COLUMN_NUMBER, 1,  "SABER INDEX, the stage 2 pattern" },
+   { "hits",     COLUMN_TEXT,   9,  "HIT REPORT" },
+   { "digits",   COLUMN_TEXT,   5,  "Digits entered, empty for none" },
+   { "runtime",  COLUMN_NUMBER, 4,  "RUN TIME, msecs" },
+};
+
+struct StoreBlock {
+   char     magic[4];
+   uint32_t rows;
+   uint32_t columns;
+   uint32_t bytes;                  // the whole block, header included
+};
+
+/* One match, as it is ingested */
+struct MatchRow {
+   int64_t     number[COLUMNS];     // the number columns
+   std::string text[COLUMNS];       // the text columns
+};
+
+static inline int findColumn(const char *name)
+{
+   for (int c=0; c < COLUMNS; c++) {
+      if (0 == strcmp(name, columnInfo[c].name)) {
+         return c;
+      }
+   }
+   return -1;
+}
+
+/* A number from its stored bytes */
+static inline int64_t readNumber(const uint8_t *p, uint8_t width)
+{
+   uint64_t value = 0;
+
+   for (int b=width - 1; b >= 0; b--) {
+      value = (value << 8) | p[b];
+   }
+   if ((width < 8) && (value & (1ULL << (width * 8 - 1)))) {
+      value |= ~0ULL << (width * 8);
+   }
+   return (int64_t) value;
+}
+
+static inline void writeNumber(uint8_t *p, uint8_t width, int64_t value)
+{
+   for (int b=0; b < width; b++) {
+      p[b] = (uint8_t) (value >> (b * 8));
+   }
+}
+
+/* Lay out a block of rows, ready to append */
+static inline void makeBlock(const std::vector<MatchRow> &rows, std::vector<uint8_t> &block)
+{
+   size_t bytes = sizeof(StoreBlock);
+   for (int c=0; c < COLUMNS; c++) {
+      bytes += rows.size() * columnInfo[c].width;
+   }
+   block.assign(bytes, 0);
+
+   StoreBlock header;
+   memcpy(header.magic, STORE_MAGIC, 4);
+   header.rows    = (uint32_t) rows.size();
+   header.columns = COLUMNS;
+   header.bytes   = (uint32_t) bytes;
+   memcpy(&block[0], &header, sizeof(header));
+
+   uint8_t *p = &block[sizeof(header)];
+   for (int c=0; c < COLUMNS; c++) {
+      uint8_t width = columnInfo[c].width;
+
+      for (size_t r=0; r < rows.size(); r++, p += width) {
+         if (COLUMN_TEXT == columnInfo[c].type) {
+            memcpy(p, rows[r].text[c].data(), std::min<size_t>(width, rows[r].text[c].size()));
+         } else {
+            writeNumber(p, width, rows[r].number[c]);
+         }
+      }
+   }
+}
+
+/* Where the columns of a block start */
+struct BlockView {
+   uint32_t       rows;
+   const uint8_t *column[COLUMNS];
+};
+
+/* Step to the next block of a mapped store - false at the end, or at a
+ *    block that is damaged or not completely written
+ */
+static inline bool nextBlock(const uint8_t *&p, const uint8_t *end, BlockView &view)
+{
+   StoreBlock header;
+
+   if ((size_t) (end - p) < sizeof(header)) {
+      return false;
+   }
+   memcpy(&header, p, sizeof(header));
+   if ((0 != memcmp(header.magic, STORE_MAGIC, 4)) || (COLUMNS != header.columns) ||
+       (header.bytes > (size_t) (end - p))) {
+      return false;
+   }
+
+   const uint8_t *c = p + sizeof(header);
+   view.rows = header.rows;
+   for (int n=0; n < COLUMNS; n++) {
+      view.column[n] = c;
+      c += (size_t) header.rows * columnInfo[n].width;
+   }
+   if (c != p + header.bytes) {
+      return false;
+   }
+   p += header.bytes;
+   return true;
+}
+
+/* True if the block nextBlock() stopped at is the last one, cut short
+ *    while it was written - too short for its header, or with a good
+ *    header and fewer bytes left than it says. Anything else that stops
+ *    nextBlock() is damage.
+ */
+static inline bool partialBlock(const uint8_t *p, const uint8_t *end)
+{
+   StoreBlock header;
+
+   if ((size_t) (end - p) < sizeof(header)) {
+      return true;
+   }
+   memcpy(&header, p, sizeof(header));
+   return (0 == memcmp(header.magic, STORE_MAGIC, 4)) && (COLUMNS == header.columns) &&
+          (header.bytes > (size_t) (end - p));
+}
+
+/* Text of a stored value, without the padding */
+static inline std::string readText(const uint8_t *p, uint8_t width)
+{
+   return std::string((const char *) p, strnlen((const char *) p, width));
+}
+
+#endif
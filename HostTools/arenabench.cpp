@@ -0,0 +1,358 @@
+/*
+ * Host microbenchmarks of the arena hot paths
+ *
+ * Times the interrupt handlers and per-pass stage logic of the sketch,
+ *    built for the host against the host core, over synthetic inputs
+ *    shaped like a match: encoder edges with contact bounce, knob traces
+ *    dialing 5 digit combinations, hit reports and sensor hits, and LCD
+ *    text. The stage .cpp files are included here rather than linked, so
+ *    their file-local functions can be called directly.
+ *
+ *    encoder_isr         encoder interrupt (QUADRATURE_MODE), per edge
+ *    digit_decoder_feed  DigitDecoder::feed center tracking, per sample
+ *    show_movement       stage 3 direction vote and LEDs, per sample
+ *    stage2_score        Stage2::score, per hit report
+ *    hit_detected        stage 2 hit polling, per call
+ *    stage3_score        stage 3 calculateScore, per dialed match
+ *    lcd_write           Sainsmart_I2CLCD character write through the
+ *                        host Wire, per character (i2c_per_op counts
+ *                        the expander writes)
+ *    stage1_start        relay table pick in Stage1::start, per call
+ *
+ * Each benchmark is run 'repeats' times and the best time is reported,
+ *    as one JSON object on stdout for regression tracking. Host times
+ *    follow changes in the logic, not AVR cycle counts.
+ *
+ * Usage: arenabench [operations] [repeats] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "HostCore.h"
+#include "Arduino.h"
+
+#include "../ArenaControl/Stage1.cpp"
+#include "../ArenaControl/Stage2.cpp"
+#include "../ArenaControl/Stage3.cpp"
+#include "../ArenaControl/ResultLog.h"
+
+#include "QuadModel.h"
+
+extern "C" void PCINT2_vect(void);
+extern "C" void TIMER2_COMPA_vect(void);
+
+/* The sketch globals the stages use */
+Controller controller;
+Stage1 stage1(controller);
+Stage2 stage2(controller);
+Stage3 stage3(stage1.turnPattern, controller);
+ResultLog Results(stage1, stage2, stage3);
+
+/* ArenaControl.ino's, for the query console */
+uint16_t getFreeSram() { return 0; }
+
+struct Bench {
+   const char *name;
+   double    (*run)(long ops);
+   long        divide;          // run operations / divide of these
+   const char *extraName;       // optional per operation counter, or NULL
+   double      extra;
+};
+
+static volatile long sink;      // keeps the results live
+
+/* Inputs, generated once */
+static std::vector<uint8_t>      encoderPins;
+static std::vector<long>         dialTrace;
+static std::vector<size_t>       dialStarts;
+static std::vector<uint8_t>      movements;     // bit 0 clockwise, bit 1 center
+static std::vector<DigitDecoder> dialed;
+static std::vector<uint16_t>     dialedPatterns;
+static std::vector<std::string>  hitReports;
+static std::vector<uint8_t>      hitStates;     // bit 0 hit, bit 1 ignoring
+static std::string               lcdText;
+
+
+static double seconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Walk the knob from 'from' to 'to' in 1..maxStep count samples, as the
+ *    arena loop sees it
+ */
+static long travel(long from, long to, int maxStep)
+{
+   long position = from;
+
+   while (position != to) {
+      long step = 1 + (rand() % maxStep);
+      if (step > labs(to - position)) {
+         step = labs(to - position);
+      }
+      position += (to > position) ? step : -step;
+      dialTrace.push_back(position);
+   }
+   return position;
+}
+
+/* Dial 'matches' random 5 digit combinations, keeping the decoder state
+ *    at the end of each for the score benchmark
+ */
+static void makeDials(long matches)
+{
+   DigitDecoder decoder;
+
+   for (long m=0; m < matches; m++) {
+      long     position = 0;
+      int      direction = 1;
+      uint16_t pattern = 0;
+
+      dialStarts.push_back(dialTrace.size());
+      for (int d=0; d < 5; d++) {
+         int digit = 1 + (rand() % 5);
+         position = travel(position, position + direction * digit * ONE_REVOLUTION, 16);
+         direction = -direction;
+         pattern = pattern * 10 + ((rand() % 4) ? digit : 1 + (rand() % 5));
+      }
+      dialedPatterns.push_back(pattern);
+   }
+
+   /* Replay once for the movement inputs and final decoder states */
+   for (size_t m=0; m < dialStarts.size(); m++) {
+      size_t end = (m + 1 < dialStarts.size()) ? dialStarts[m+1] : dialTrace.size();
+
+      decoder.reset();
+      for (size_t s=dialStarts[m]; s < end; s++) {
+         bool clockwise = (dialTrace[s] > decoder.position());
+         decoder.feed(dialTrace[s]);
+         movements.push_back((clockwise ? 1 : 0) | (decoder.inCenter() ? 2 : 0));
+      }
+      dialed.push_back(decoder);
+   }
+}
+
+/* Hit reports as stage 2 leaves them - at most 5 good hits */
+static void makeHitReports(long count)
+{
+   for (long n=0; n < count; n++) {
+      std::string report(9, '.');
+      int good = 0;
+
+      for (size_t c=0; c < report.size(); c++) {
+         int r = rand() % 20;
+         if ((r < 7) && (good < 5)) {
+            report[c] = '+';
+            good++;
+         } else if (r < 10) {
+            report[c] = '-';
+         }
+      }
+      hitReports.push_back(report);
+   }
+}
+
+
+static double encoderIsr(long ops)
+{
+   double start = seconds();
+   size_t e = 0;
+
+   for (long n=0; n < ops; n++) {
+      hostSetPins(ENCODER_A_PIN, 3, encoderPins[e]);
+#if QUADRATURE_MODE == QUADRATURE_SAMPLED
+      TIMER2_COMPA_vect();
+#else
+      PCINT2_vect();
+#endif
+      e = (e + 1 < encoderPins.size()) ? e + 1 : 0;
+   }
+   sink = Quadrature.read();
+   return seconds() - start;
+}
+
+static double digitDecoderFeed(long ops)
+{
+   double start = seconds();
+   size_t s = 0, m = 0;
+   long   digits = 0;
+
+   for (long n=0; n < ops; n++) {
+      if ((m < dialStarts.size()) && (s == dialStarts[m])) {
+         knob.decoder.reset();
+         m++;
+      }
+      digits += knob.decoder.feed(dialTrace[s]);
+      if (++s == dialTrace.size()) {
+         s = m = 0;
+      }
+   }
+   sink = digits;
+   return seconds() - start;
+}
+
+static double showMovementBench(long ops)
+{
+   double start = seconds();
+   size_t s = 0;
+
+   for (long n=0; n < ops; n++) {
+      showMovement(movements[s] & 1, movements[s] & 2);
+      s = (s + 1 < movements.size()) ? s + 1 : 0;
+   }
+   sink = knob.movementHistory;
+   return seconds() - start;
+}
+
+static double stage2Score(long ops)
+{
+   double start = seconds();
+   size_t r = 0;
+   long   total = 0;
+
+   for (long n=0; n < ops; n++) {
+      memcpy(saber.hitReport, hitReports[r].c_str(), sizeof(saber.hitReport));
+      total += stage2.score();
+      r = (r + 1 < hitReports.size()) ? r + 1 : 0;
+   }
+   sink = total;
+   return seconds() - start;
+}
+
+static double hitDetected(long ops)
+{
+   double start = seconds();
+   size_t h = 0;
+   long   hits = 0;
+
+   for (long n=0; n < ops; n++) {
+      hit = hitStates[h] & 1;
+      saber.ignoreHits = (hitStates[h] >> 1) & 1;
+      hits += hit_detected();
+      h = (h + 1 < hitStates.size()) ? h + 1 : 0;
+   }
+   sink = hits;
+   return seconds() - start;
+}
+
+static double stage3Score(long ops)
+{
+   double start = seconds();
+   size_t m = 0;
+   long   total = 0;
+
+   for (long n=0; n < ops; n++) {
+      knob.decoder = dialed[m];
+      knob.turnPattern = dialedPatterns[m];
+      Quadrature.value = knob.decoder.position();
+      calculateScore();
+      total += stageScore;
+      m = (m + 1 < dialed.size()) ? m + 1 : 0;
+   }
+   sink = total;
+   return seconds() - start;
+}
+
+static double lcdWrite(long ops)
+{
+   double start = seconds();
+   size_t c = 0;
+
+   controller.lcdp()->setCursor(0, 0);
+   for (long n=0; n < ops; n++) {
+      controller.lcdp()->write((uint8_t) lcdText[c]);
+      c = (c + 1 < lcdText.size()) ? c + 1 : 0;
+   }
+   return seconds() - start;
+}
+
+static double stage1Start(long ops)
+{
+   double start = seconds();
+   long   total = 0;
+
+   for (long n=0; n < ops; n++) {
+      stage1.start();
+      total += stage1.relayPattern ^ stage1.turnPattern;
+   }
+   sink = total;
+   return seconds() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+   long     operations = (argc > 1) ? atol(argv[1]) : 1000000;
+   int      repeats    = (argc > 2) ? atoi(argv[2]) : 5;
+   unsigned seed       = (argc > 3) ? atoi(argv[3]) : 2017;
+   Bench    benches[]  = {
+      { "encoder_isr",         encoderIsr,         1,   NULL, 0 },
+      { "digit_decoder_feed",  digitDecoderFeed,   1,   NULL, 0 },
+      { "show_movement",       showMovementBench,  1,   NULL, 0 },
+      { "stage2_score",        stage2Score,        1,   NULL, 0 },
+      { "hit_detected",        hitDetected,        1,   NULL, 0 },
+      { "stage3_score",        stage3Score,        20,  NULL, 0 },
+      { "lcd_write",           lcdWrite,           10,  "i2c_per_op", 0 },
+      { "stage1_start",        stage1Start,        1,   NULL, 0 },
+   };
+   size_t   count = sizeof(benches) / sizeof(benches[0]);
+
+   /* Inputs */
+   srand(seed);
+   Waveform wave = makeWaveform(4000, 5000, 0.2, 2, 20.0, 0.05);
+   for (size_t e=0; e < wave.edges.size(); e++) {
+      encoderPins.push_back(wave.edges[e].pins);
+   }
+   makeDials(200);
+   makeHitReports(1000);
+   for (int n=0; n < 1024; n++) {
+      hitStates.push_back(((0 == rand() % 4) ? 1 : 0) | ((0 == rand() % 8) ? 2 : 0));
+   }
+   lcdText = "1: 11  31524       2: 145 #2 +-+..-+..3: 325 31524";
+
+   /* Board - controller attached, stage code started as in a match */
+   hostConfig.lcdAttached   = true;
+   hostConfig.relayAttached = true;
+   randomSeed(seed);
+   controller.lcdp()->init();
+   stage1.start();
+   stage3.start();
+
+   printf("{\"tool\": \"arenabench\", \"mode\": \"%s\", \"resolution\": %d, "
+          "\"operations\": %ld, \"repeats\": %d, \"seed\": %u, \"results\": [\n",
+          (QUADRATURE_MODE == QUADRATURE_SAMPLED) ? "sampled" : "edge",
+          QUADRATURE_RESOLUTION, operations, repeats, seed);
+
+   for (size_t b=0; b < count; b++) {
+      Bench &bench = benches[b];
+      long   ops = operations / bench.divide;
+      double best = 0;
+
+      for (int r=0; r < repeats; r++) {
+         uint64_t transfers = hostStats.i2cTransfers;
+         double   elapsed = bench.run(ops);
+
+         if ((0 == r) || (elapsed < best)) {
+            best = elapsed;
+         }
+         bench.extra = (double) (hostStats.i2cTransfers - transfers) / ops;
+      }
+
+      printf("   {\"name\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.2f, \"mops_per_s\": %.3f",
+             bench.name, ops, best * 1e9 / ops, ops / best / 1e6);
+      if (bench.extraName) {
+         printf(", \"%s\": %.2f", bench.extraName, bench.extra);
+      }
+      printf("}%s\n", (b + 1 < count) ? "," : "");
+   }
+   printf("]}\n");
+   return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Ingest arena serial captures into a columnar results store
+ *
+ * Reads serial captures (the report text of loop() and the report()
+ *    functions, with or without the input trace records of Trace.h mixed
+ *    in), takes each match out of them as one row of typed columns - see
+ *    ResultStore.h - and appends the rows to the store for arenaquery.
+ *
+ * A capture is named after its file (the name up to the first '.'), or
+ *    given a name as name=file. Each match row records where it ended
+ *    in its capture, so running again over the same captures carries on
+ *    after the last match stored for each name rather than storing the
+ *    matches again.
+ *
+ * With -f the captures are followed as they grow, as 'tail -f' does,
+ *    which is how a capture being written by an arena's serial logger is
+ *    read during an event. All captures are read by the one process,
+ *    each from where it got to, and the matches finished since the last
+ *    pass are appended together as one block. Several ingesters (one per
+ *    scoring table, say) can append to the same store.
+ *
+ * Usage: arenaingest [-f] [-i seconds] store [name=]capture...
+ *    -f  follow the captures, until interrupted
+ *    -i  seconds between passes when following, default 1
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <avr/pgmspace.h>
+
+#include "relayTable.h"
+#include "ResultStore.h"
+
+#define TRACE_RECORD_BYTES  8       // sizeof(TraceRecord), see Trace.h
+#define READ_BYTES          65536
+#define MAX_LINE            256     // longer lines are not report lines
+
+/* A capture being read */
+struct Capture {
+   std::string name;
+   std::string path;
+   int         fd;
+   int64_t     position;            // bytes read so far
+   int         skip;                // trace record bytes still to skip
+   std::string line;
+   bool        open;                // in a match's results
+   int         section;             // stage report being read, 0 before any
+   MatchRow    row;
+};
+
+static volatile sig_atomic_t stopping = 0;
+
+static void interrupted(int sig)
+{
+   stopping = 1;
+}
+
+static double wallSeconds(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static bool startsWith(const std::string &line, const char *key, const char *&rest)
+{
+   size_t length = strlen(key);
+   if (0 != line.compare(0, length, key)) {
+      return false;
+   }
+   rest = line.c_str() + length;
+   return true;
+}
+
+/* A new row, with nothing read yet */
+static void openMatch(Capture &capture)
+{
+   for (int c=0; c < COLUMNS; c++) {
+      capture.row.number[c] = STORE_NO_VALUE;
+      capture.row.text[c].clear();
+   }
+   capture.row.text[COL_ARENA] = capture.name;
+   capture.open = true;
+   capture.section = 0;
+}
+
+/* One line of a capture - a row is done at the stage 3 Digits entered */
+static void readLine(Capture &capture, std::vector<MatchRow> &rows)
+{
+   const std::string &line = capture.line;
+   MatchRow          &row = capture.row;
+   const char        *rest;
+
+   if (startsWith(line, "------ RESULTS ------", rest)) {
+      openMatch(capture);
+   } else if (!capture.open) {
+      return;
+   } else if (startsWith(line, "FINAL SCORE: ", rest)) {
+      row.number[COL_SCORE] = atol(rest);
+   } else if (startsWith(line, "RANDOM SEED: ", rest)) {
+      row.number[COL_SEED] = atol(rest);
+   } else if (startsWith(line, "RUN TIME: ", rest)) {
+      row.number[COL_RUNTIME] = atol(rest);
+   } else if (startsWith(line, "------ Stage ", rest)) {
+      capture.section = atoi(rest);
+   } else if (startsWith(line, "RELAY INDEX: ", rest)) {
+      long relay = atol(rest);
+      row.number[COL_RELAY] = relay;
+      if ((relay >= 0) && ((size_t) relay < RELAY_TABLE_LENGTH)) {
+         row.number[COL_TURNS] = pgm_read_word_near((relayTable[relay]) + 1);
+      }
+   } else if (startsWith(line, "SABER INDEX: ", rest)) {
+      row.number[COL_SABER] = atol(rest);
+   } else if (startsWith(line, "HIT REPORT : [", rest)) {
+      const char *end = strchr(rest, ']');
+      row.text[COL_HITS].assign(rest, end ? end - rest : strlen(rest));
+   } else if (startsWith(line, "STAGE SCORE: ", rest)) {
+      if (2 == capture.section) {
+         row.number[COL_STAGE2] = atol(rest);
+      } else if (3 == capture.section) {
+         row.number[COL_STAGE3] = atol(rest);
+      }
+   } else if (startsWith(line, "Digits entered: ", rest)) {
+      row.text[COL_DIGITS] = ('-' == rest[0]) ? "" : rest;
+      row.number[COL_OFFSET]   = capture.position;
+      row.number[COL_INGESTED] = time(NULL);
+      rows.push_back(row);
+      capture.open = false;
+   }
+}
+
+/* The new bytes of a capture - binary trace records (a byte with the
+ *    high bit set and the 7 after it) are taken out of the text
+ */
+static void readBytes(Capture &capture, const char *data, size_t length,
+                      std::vector<MatchRow> &rows)
+{
+   for (size_t n=0; n < length; n++) {
+      char c = data[n];
+
+      capture.position++;
+      if (capture.skip > 0) {
+         capture.skip--;
+      } else if (c & 0x80) {
+         capture.skip = TRACE_RECORD_BYTES - 1;
+      } else if ('\n' == c) {
+         readLine(capture, rows);
+         capture.line.clear();
+      } else if (('\r' != c) && (capture.line.size() < MAX_LINE)) {
+         capture.line += c;
+      }
+   }
+}
+
+/* Read what has been added to a capture - false (and errno) if it can't
+ *    be read
+ */
+static bool readCapture(Capture &capture, std::vector<MatchRow> &rows, size_t &bytes)
+{
+   static char buffer[READ_BYTES];
+   struct stat st;
+
+   if (capture.fd < 0) {
+      capture.fd = open(capture.path.c_str(), O_RDONLY);
+      if (capture.fd < 0) {
+         return false;
+      }
+      lseek(capture.fd, capture.position, SEEK_SET);
+   }
+
+   /* Started again (truncated by the logger) - read it from the top */
+   if ((0 == fstat(capture.fd, &st)) && (st.st_size < capture.position)) {
+      fprintf(stderr, "arenaingest: %s is shorter, reading it again\n", capture.path.c_str());
+      lseek(capture.fd, 0, SEEK_SET);
+      capture.position = 0;
+      capture.skip = 0;
+      capture.line.clear();
+      capture.open = false;
+   }
+
+   for (;;) {
+      ssize_t got = read(capture.fd, buffer, sizeof(buffer));
+      if (got < 0) {
+         if (EINTR == errno) {
+            continue;
+         }
+         return false;
+      }
+      if (0 == got) {
+         return true;
+      }
+      readBytes(capture, buffer, got, rows);
+      bytes += got;
+   }
+}
+
+/* Check the store, drop a block left part written at its end, and find
+ *    where each capture got to. A damaged block anywhere else stops the
+ *    ingest rather than losing the blocks after it.
+ */
+static void openStore(int fd, const char *path, std::map<std::string, int64_t> &resume)
+{
+   struct stat st;
+   fstat(fd, &st);
+   if (0 == st.st_size) {
+      return;
+   }
+
+   const uint8_t *data = (const uint8_t *) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   if (MAP_FAILED == data) {
+      perror(path);
+      exit(2);
+   }
+
+   const uint8_t *p = data, *end = data + st.st_size;
+   BlockView      view;
+   while (nextBlock(p, end, view)) {
+      for (uint32_t r=0; r < view.rows; r++) {
+         std::string name = readText(view.column[COL_ARENA] + r * columnInfo[COL_ARENA].width,
+                                     columnInfo[COL_ARENA].width);
+         int64_t offset = readNumber(view.column[COL_OFFSET] + r * columnInfo[COL_OFFSET].width,
+                                     columnInfo[COL_OFFSET].width);
+         if (offset > resume[name]) {
+            resume[name] = offset;
+         }
+      }
+   }
+   if ((p != end) && !partialBlock(p, end)) {
+      fprintf(stderr, "arenaingest: %s: damaged block at byte %ld, not appending\n",
+              path, (long) (p - data));
+      exit(2);
+   }
+   if (p != end) {
+      fprintf(stderr, "arenaingest: %s: dropping %ld bytes of a block not completely written\n",
+              path, (long) (end - p));
+      if (0 != ftruncate(fd, p - data)) {
+         perror(path);
+         exit(2);
+      }
+   }
+   munmap((void *) data, st.st_size);
+}
+
+/* Append the rows as one block */
+static void append(int fd, const char *path, const std::vector<MatchRow> &rows)
+{
+   std::vector<uint8_t> block;
+   makeBlock(rows, block);
+
+   flock(fd, LOCK_EX);
+   lseek(fd, 0, SEEK_END);
+   for (size_t done=0; done < block.size(); ) {
+      ssize_t put = write(fd, &block[done], block.size() - done);
+      if (put < 0) {
+         if (EINTR == errno) {
+            continue;
+         }
+         perror(path);
+         exit(2);
+      }
+      done += put;
+   }
+   flock(fd, LOCK_UN);
+}
+
+int main(int argc, char **argv)
+{
+   bool   follow = false;
+   double interval = 1;
+   int    opt;
+
+   while (-1 != (opt = getopt(argc, argv, "fi:"))) {
+      switch (opt) {
+         case 'f': follow   = true;            break;
+         case 'i': interval = atof(optarg);    break;
+         default:
+            fprintf(stderr, "usage: arenaingest [-f] [-i seconds] store [name=]capture...\n");
+            return 2;
+      }
+   }
+   if (argc - optind < 2) {
+      fprintf(stderr, "usage: arenaingest [-f] [-i seconds] store [name=]capture...\n");
+      return 2;
+   }
+
+   const char *storePath = argv[optind];
+   int store = open(storePath, O_RDWR | O_CREAT, 0644);
+   if (store < 0) {
+      perror(storePath);
+      return 2;
+   }
+
+   std::map<std::string, int64_t> resume;
+   flock(store, LOCK_EX);
+   openStore(store, storePath, resume);
+   flock(store, LOCK_UN);
+
+   std::vector<Capture> captures;
+   for (int a=optind + 1; a < argc; a++) {
+      Capture     capture;
+      const char *equals = strchr(argv[a], '=');
+
+      if (equals) {
+         capture.name.assign(argv[a], equals - argv[a]);
+         capture.path = equals + 1;
+      } else {
+         const char *base = strrchr(argv[a], '/');
+         capture.path = argv[a];
+         capture.name = base ? base + 1 : argv[a];
+         capture.name = capture.name.substr(0, capture.name.find('.'));
+      }
+      if (capture.name.size() > columnInfo[COL_ARENA].width) {
+         fprintf(stderr, "arenaingest: %s is too long a name, %d characters at most\n",
+                 capture.name.c_str(), columnInfo[COL_ARENA].width);
+         return 2;
+      }
+      capture.fd       = -1;
+      capture.position = resume[capture.name];
+      capture.skip     = 0;
+      capture.open     = false;
+      capture.section  = 0;
+      captures.push_back(capture);
+   }
+
+   signal(SIGINT, interrupted);
+   signal(SIGTERM, interrupted);
+
+   double started = wallSeconds();
+   size_t bytes = 0, matches = 0;
+   bool   failed = false;
+
+   do {
+      std::vector<MatchRow> rows;
+
+      for (size_t c=0; c < captures.size(); c++) {
+         if (!readCapture(captures[c], rows, bytes) && !follow) {
+            perror(captures[c].path.c_str());
+            failed = true;
+         }
+      }
+      if (!rows.empty()) {
+         append(store, storePath, rows);
+         matches += rows.size();
+         if (follow) {
+            fprintf(stderr, "arenaingest: %zu matches stored\n", rows.size());
+         }
+      }
+      if (follow && !stopping) {
+         usleep((useconds_t) (interval * 1e6));
+      }
+   } while (follow && !stopping);
+
+   double elapsed = wallSeconds() - started;
+   fprintf(stderr, "%zu captures, %.1f MB read, %zu matches stored, %.2fs (%.0f MB/s)\n",
+           captures.size(), bytes / 1e6, matches, elapsed,
+           elapsed > 0 ? bytes / 1e6 / elapsed : 0.0);
+   close(store);
+   return failed ? 2 : 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * Aggregate queries over a columnar results store
+ *
+ * Reads a store written by arenaingest (see ResultStore.h). The store is
+ *    memory mapped and only the columns a query uses are read, straight
+ *    from the mapping, so a query over an event is a scan of a few
+ *    arrays rather than a parse of its logs.
+ *
+ *    arenaquery store                      the columns and how many matches
+ *    arenaquery store stage2 by saber      count, mean, min and max of a
+ *                                          number column, for each value
+ *                                          of another column
+ *    arenaquery store score                ... over all the matches
+ *    arenaquery -l store                   list the matches
+ *
+ * Where clauses (-w column=value, or column<value, column>value for
+ *    number columns) pick the matches, and can be repeated:
+ *
+ *    arenaquery -w arena=A3 -w runtime<240000 store stage3 by turns
+ *
+ * Matches a report did not have a number for (a capture from before
+ *    RUN TIME was printed, say) are left out of that column's numbers.
+ *
+ * Usage: arenaquery [-l] [-w clause]... store [column [by column]]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ResultStore.h"
+
+/* A where clause */
+struct Clause {
+   int         column;
+   char        test;                // '=', '<' or '>'
+   int64_t     number;
+   std::string text;
+};
+
+/* A group of matches */
+struct Key {
+   int64_t     number;
+   std::string text;
+
+   bool operator<(const Key &other) const {
+      return (number != other.number) ? (number < other.number) : (text < other.text);
+   }
+};
+
+struct Totals {
+   long    count;
+   long    valued;                  // matches with a value
+   int64_t sum;
+   int64_t min;
+   int64_t max;
+};
+
+static void usage(void)
+{
+   fprintf(stderr, "usage: arenaquery [-l] [-w column=value|column<value|column>value]... "
+                   "store [column [by column]]\n");
+   exit(2);
+}
+
+static int columnNamed(const char *name)
+{
+   int column = findColumn(name);
+   if (column < 0) {
+      fprintf(stderr, "arenaquery: no column %s\n", name);
+      exit(2);
+   }
+   return column;
+}
+
+static Clause parseClause(const char *text)
+{
+   const char *test = strpbrk(text, "=<>");
+   Clause      clause;
+
+   if (NULL == test) {
+      usage();
+   }
+   clause.column = columnNamed(std::string(text, test - text).c_str());
+   clause.test   = *test;
+   clause.text   = test + 1;
+   clause.number = atoll(test + 1);
+   if ((COLUMN_TEXT == columnInfo[clause.column].type) && ('=' != clause.test)) {
+      fprintf(stderr, "arenaquery: %s is text, it can only be compared with =\n",
+              columnInfo[clause.column].name);
+      exit(2);
+   }
+   return clause;
+}
+
+/* Row r of a block's column */
+static inline const uint8_t *cell(const BlockView &view, int column, uint32_t r)
+{
+   return view.column[column] + (size_t) r * columnInfo[column].width;
+}
+
+static inline int64_t numberAt(const BlockView &view, int column, uint32_t r)
+{
+   return readNumber(cell(view, column, r), columnInfo[column].width);
+}
+
+static bool passes(const BlockView &view, uint32_t r, const std::vector<Clause> &clauses)
+{
+   for (size_t c=0; c < clauses.size(); c++) {
+      const Clause &clause = clauses[c];
+
+      if (COLUMN_TEXT == columnInfo[clause.column].type) {
+         uint8_t width = columnInfo[clause.column].width;
+         if (0 != strncmp((const char *) cell(view, clause.column, r), clause.text.c_str(), width)) {
+            return false;
+         }
+      } else {
+         int64_t value = numberAt(view, clause.column, r);
+         if ((('=' == clause.test) && (value != clause.number)) ||
+             (('<' == clause.test) && (value >= clause.number)) ||
+             (('>' == clause.test) && (value <= clause.number))) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+static void printCell(const BlockView &view, int column, uint32_t r, const char *format)
+{
+   char value[32];
+
+   if (COLUMN_TEXT == columnInfo[column].type) {
+      std::string text = readText(cell(view, column, r), columnInfo[column].width);
+      printf(format, text.empty() ? "-" : text.c_str());
+   } else {
+      int64_t number = numberAt(view, column, r);
+      if (STORE_NO_VALUE == number) {
+         printf(format, "-");
+      } else {
+         snprintf(value, sizeof(value), "%lld", (long long) number);
+         printf(format, value);
+      }
+   }
+}
+
+int main(int argc, char **argv)
+{
+   std::vector<Clause> clauses;
+   bool list = false;
+   int  opt;
+
+   while (-1 != (opt = getopt(argc, argv, "lw:"))) {
+      switch (opt) {
+         case 'l': list = true;                            break;
+         case 'w': clauses.push_back(parseClause(optarg)); break;
+         default:  usage();
+      }
+   }
+
+   int args = argc - optind;
+   if ((args != 1) && (args != 2) && !((4 == args) && (0 == strcmp(argv[optind + 2], "by")))) {
+      usage();
+   }
+   const char *path = argv[optind];
+   int value = (args >= 2) ? columnNamed(argv[optind + 1]) : -1;
+   int group = (4 == args) ? columnNamed(argv[optind + 3]) : -1;
+
+   if ((value >= 0) && (COLUMN_TEXT == columnInfo[value].type)) {
+      fprintf(stderr, "arenaquery: %s is text, count matches by it instead\n",
+              columnInfo[value].name);
+      return 2;
+   }
+
+   int fd = open(path, O_RDONLY);
+   struct stat st;
+   if ((fd < 0) || (0 != fstat(fd, &st))) {
+      perror(path);
+      return 2;
+   }
+   const uint8_t *data = NULL;
+   if (st.st_size > 0) {
+      data = (const uint8_t *) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (MAP_FAILED == data) {
+         perror(path);
+         return 2;
+      }
+   }
+
+   const uint8_t         *p = data, *end = data + st.st_size;
+   BlockView              view;
+   long                   blocks = 0, rows = 0, picked = 0;
+   std::map<Key, Totals>  totals;
+
+   if (list) {
+      for (int c=0; c < COLUMNS; c++) {
+         printf("%s%s", columnInfo[c].name, (c + 1 < COLUMNS) ? "\t" : "\n");
+      }
+   }
+
+   while (nextBlock(p, end, view)) {
+      blocks++;
+      rows += view.rows;
+
+      for (uint32_t r=0; r < view.rows; r++) {
+         if (!passes(view, r, clauses)) {
+            continue;
+         }
+         picked++;
+
+         if (list) {
+            for (int c=0; c < COLUMNS; c++) {
+               printCell(view, c, r, (c + 1 < COLUMNS) ? "%s\t" : "%s\n");
+            }
+         }
+         if (value < 0) {
+            continue;
+         }
+
+         Key key = { 0, "" };
+         if ((group >= 0) && (COLUMN_TEXT == columnInfo[group].type)) {
+            key.text = readText(cell(view, group, r), columnInfo[group].width);
+         } else if (group >= 0) {
+            key.number = numberAt(view, group, r);
+         }
+
+         Totals &t = totals[key];
+         int64_t n = numberAt(view, value, r);
+         t.count++;
+         if (STORE_NO_VALUE != n) {
+            t.min = (0 == t.valued) ? n : std::min(t.min, n);
+            t.max = (0 == t.valued) ? n : std::max(t.max, n);
+            t.sum += n;
+            t.valued++;
+         }
+      }
+   }
+
+   if ((value < 0) && !list) {
+      printf("# %s: %ld matches in %ld blocks, %.1f KB%s\n", path, rows, blocks,
+             st.st_size / 1e3, (p != end) ? ", ends with a block not completely written" : "");
+      for (int c=0; c < COLUMNS; c++) {
+         printf("%-10s %-6s %d  %s\n", columnInfo[c].name,
+                (COLUMN_TEXT == columnInfo[c].type) ? "text" : "number",
+                columnInfo[c].width, columnInfo[c].about);
+      }
+   } else if (value >= 0) {
+      printf("# %s: %s of %ld of %ld matches\n", path, columnInfo[value].name, picked, rows);
+      printf("%-10s %8s %10s %8s %8s\n", (group >= 0) ? columnInfo[group].name : "",
+             "matches", "mean", "min", "max");
+      for (std::map<Key, Totals>::const_iterator g=totals.begin(); g != totals.end(); ++g) {
+         const Totals &t = g->second;
+         char name[32];
+
+         if (group < 0) {
+            snprintf(name, sizeof(name), "all");
+         } else if (COLUMN_TEXT == columnInfo[group].type) {
+            snprintf(name, sizeof(name), "%s", g->first.text.empty() ? "-" : g->first.text.c_str());
+         } else if (STORE_NO_VALUE == g->first.number) {
+            snprintf(name, sizeof(name), "-");
+         } else {
+            snprintf(name, sizeof(name), "%lld", (long long) g->first.number);
+         }
+         if (t.valued) {
+            printf("%-10s %8ld %10.1f %8lld %8lld\n", name, t.count, (double) t.sum / t.valued,
+                   (long long) t.min, (long long) t.max);
+         } else {
+            printf("%-10s %8ld %10s %8s %8s\n", name, t.count, "-", "-", "-");
+         }
+      }
+   }
+
+   if (data) {
+      munmap((void *) data, st.st_size);
+   }
+   close(fd);
+   return 0;
+}
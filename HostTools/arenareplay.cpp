@@ -0,0 +1,488 @@
+/*
+ * Replay recorded match input traces through the sketch
+ *
+ * Reads raw serial captures from an arena built with TRACE_RECORD (or
+ *    from arenasim -o), which interleave the text log with the binary
+ *    input trace records of Trace.h. A capture may hold any number of
+ *    matches - each START record begins a new one - so a whole
+ *    tournament can be one file.
+ *
+ * The captures are memory mapped and read in place. Each match is
+ *    replayed in a forked child (which shares the mapping) by running
+ *    the unchanged sketch on the host core: the recorded encoder,
+ *    vibration and button changes are driven onto the pins at their
+ *    recorded times relative to the start of the match, and loop() is
+ *    called at the recorded start of each pass. The replayed relay
+ *    pattern, saber pattern and stage scores are checked against the
+ *    recorded ones.
+ *
+ * A match the watchdog reset and the sketch resumed from a checkpoint
+ *    (see Checkpoint.h) is replayed the same way: the boot before the
+ *    reset runs its recorded passes and then its inputs up to the
+ *    reset (the resumed sketch sends those it had not), the watchdog
+ *    then resets it, and a fresh copy of the sketch (a child forked
+ *    before setup(), as in arenasim) resumes from the checkpoint and
+ *    the encoder count the replay itself kept, with the encoder pins
+ *    as the RESUME record has them. The inputs after the RESUME record
+ *    are timed from that reset, and the encoder count the replay
+ *    resumed with is checked against the one recorded. Captures from
+ *    before trace version 2 do not have the inputs up to the reset or
+ *    the pins, and a reset while the knob turns does not replay.
+ *
+ * The saber pattern is picked from micros() at the first hit, which the
+ *    host clock cannot reproduce to the microsecond. If the replay picks
+ *    a different pattern it is run again with micros() offset so that it
+ *    picks the recorded one.
+ *
+ * Usage: arenareplay [-v] [-r] [-m match] capture...
+ *    -v  print the replayed serial text log
+ *    -r  replay in real time instead of as fast as possible
+ *    -m  only replay match number n (counting from 1 across captures)
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "HostCore.h"
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "Quadrature.h"
+#include "Stage2.h"
+#include "Stage3.h"
+#include "Trace.h"
+#include "Telemetry.h"
+
+#define VIBRATE_PIN      2
+#define RUN_LIMIT_MS     300000     // give up this long after the match start
+
+#define EXIT_MATCHED     0
+#define EXIT_MISMATCH    1
+#define EXIT_ERROR       2
+#define EXIT_RESET       3          // a boot ended at a recorded reset
+#define EXIT_OFFSET      10         // + micros() offset to pick the saber pattern
+
+#define HANDOVER_BYTES   (16 << 20)
+
+/* The sketch */
+void setup(void);
+void loop(void);
+extern Stage2 stage2;
+extern Stage3 stage3;
+
+/* One match in a mapped capture - the bytes from its START record up to
+ *    the next START record
+ */
+struct MatchRange {
+   const char    *file;
+   int            number;
+   const uint8_t *begin;
+   const uint8_t *end;
+};
+
+/* What the trace says the match should score */
+struct Recorded {
+   uint16_t seed;
+   bool     attached;
+   int      relay;              // -1 if not recorded
+   int      saber;
+   int      stage2;
+   int      stage3;
+   int      total;
+   bool     ended;
+   uint32_t lost;
+};
+
+struct Options {
+   bool verbose;
+   bool realTime;
+   int  only;
+};
+
+/* Shared with the boots of a match that was reset: the board as the
+ *    reset left it, then the serial output of the boots so far
+ */
+struct Handover {
+   uint64_t at;                 // virtual time of the reset
+   uint8_t  pind;               // input levels - vibration and encoder
+   uint8_t  pinc;               // and the buttons
+   bool     differs;            // a boot resumed from another checkpoint
+   size_t   loops;              // passes replayed so far
+   size_t   board;
+   size_t   output;
+   char     data[1];
+};
+
+static double wallSeconds(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Walk a capture - text bytes are ASCII, a byte with the high bit set
+ *    starts an 8 byte record. Returns the next record at or after 'p',
+ *    or NULL at the end.
+ */
+static const uint8_t *nextRecord(const uint8_t *p, const uint8_t *end, TraceRecord &record)
+{
+   while ((p < end) && !(*p & 0x80)) {
+      p++;
+   }
+   if (end - p < (long) sizeof(TraceRecord)) {
+      return NULL;
+   }
+   memcpy(&record, p, sizeof(TraceRecord));
+   return p;
+}
+
+/* The text log of a capture, without the trace records */
+static std::string textOf(const std::string &capture)
+{
+   std::string text;
+   for (size_t i=0; i < capture.size(); ) {
+      if (capture[i] & 0x80) {
+         i += sizeof(TraceRecord);
+      } else {
+         text += capture[i++];
+      }
+   }
+   return text;
+}
+
+static std::string logField(const std::string &log, const char *key)
+{
+   size_t start = log.rfind(key);
+
+   if (std::string::npos == start) {
+      return "?";
+   }
+   start += strlen(key);
+   return log.substr(start, log.find_first_of("\r\n]", start) - start);
+}
+
+static void findMatches(const char *file, const uint8_t *data, size_t size,
+                        std::vector<MatchRange> &matches)
+{
+   const uint8_t *end = data + size;
+   const uint8_t *p = data;
+   TraceRecord    record;
+
+   while (NULL != (p = nextRecord(p, end, record))) {
+      if (TRACE_START == record.type) {
+         if (!matches.empty() && (matches.back().file == file)) {
+            matches.back().end = p;
+         }
+         MatchRange range = { file, (int) matches.size() + 1, p, end };
+         matches.push_back(range);
+      }
+      p += sizeof(TraceRecord);
+   }
+}
+
+/* Schedule the inputs of one boot and collect the times of its passes.
+ *    The first boot's inputs are timed from the match start, as the
+ *    replay presses START then, and a resumed boot's from its reset
+ *    (micros() counts from 0 again). Returns the time of the last input.
+ */
+static uint64_t schedule(const uint8_t *from, const uint8_t *to, bool resumed, uint64_t start,
+                         std::vector<uint64_t> &loops)
+{
+   uint64_t    lastInput  = start;
+   TraceRecord record;
+   uint64_t    recordTime = 0;
+   uint64_t    matchTime  = 0;          // recorded match start, unwrapped us
+   bool        timed      = resumed;
+   uint32_t    last       = 0;
+
+   for (const uint8_t *p = from; NULL != (p = nextRecord(p, to, record)); p += sizeof(record)) {
+      if (record.type >= TELEMETRY_FRAME) {
+         continue;              // telemetry frames have no time field
+      }
+      bool first = (TRACE_START == record.type) || (TRACE_RESUME == record.type);
+      recordTime += first ? record.time : (int32_t) (record.time - last);
+      last = record.time;
+
+      if (TRACE_MATCH == record.type) {
+         matchTime = recordTime;
+         timed = true;
+      }
+      if (!timed || (recordTime < matchTime)) {
+         continue;
+      }
+
+      uint64_t at = start + HOST_US(recordTime - matchTime);
+      if (TRACE_LOOP != record.type) {
+         lastInput = std::max(lastInput, at);
+      }
+      switch (record.type) {
+         case TRACE_ENCODER: hostDrivePins(at, ENCODER_A_PIN, 3, record.data);    break;
+         case TRACE_VIBRATE: hostDrivePin(at, VIBRATE_PIN, record.data);         break;
+         case TRACE_BUTTONS: hostDrivePins(at, A0, 0x0F, ~record.data & 0x0F);   break;
+         case TRACE_LOOP:    loops.push_back(at);                                break;
+      }
+   }
+   return lastInput;
+}
+
+/* Run one boot of a match - up to the next recorded reset, or to the
+ *    end, where it prints the comparison
+ */
+static int replayBoot(const MatchRange &range, const Options &options, const Recorded &rec,
+                      const std::vector<const uint8_t *> &resumes, size_t boot, Handover *handover)
+{
+   const uint8_t *from = boot ? resumes[boot - 1] : range.begin;
+   const uint8_t *to   = (boot < resumes.size()) ? resumes[boot] : range.end;
+   std::vector<uint64_t> loops;
+   std::string output;
+   size_t      passes  = 0;
+   bool        halted  = false;
+   bool        differs = false;
+   double      wallStart = 0;
+
+   TraceRecord first, resume;      // START of the match, and RESUME of this boot
+
+   if (boot > 0) {
+      nextRecord(range.begin, range.end, first);
+      nextRecord(from, to, resume);
+      hostLoadBoard(std::string(handover->data, handover->board), handover->at);
+      hostSetPins(0, 0x1C, handover->pind);
+      hostSetPins(A0, 0x0F, handover->pinc);
+      if (first.data >= 2) {
+         hostSetPins(ENCODER_A_PIN, 3, resume.data);
+      }
+      output.assign(handover->data + handover->board, handover->output);
+      passes  = handover->loops;
+      differs = handover->differs;
+   } else {
+      /* Hold START from reset until the sketch has seen it */
+      hostDrivePin(0, A0, LOW);
+   }
+
+   try {
+      setup();
+
+      uint64_t start = boot ? handover->at : hostNow();
+      if (boot > 0) {
+         differs |= ((uint16_t) Quadrature.read() != resume.value);
+      } else {
+         hostDrivePin(start, A0, HIGH);
+      }
+      uint64_t lastInput = schedule(from, to, boot > 0, start, loops);
+
+      /* Loop passes at their recorded times, then free running */
+      wallStart = wallSeconds();
+      for (size_t n=0; n < loops.size(); n++) {
+         if (options.realTime) {
+            double wait = (loops[n] - start) / 1e9 - (wallSeconds() - wallStart);
+            if (wait > 0) {
+               usleep((useconds_t) (wait * 1e6));
+            }
+         }
+         hostRunUntil(loops[n]);
+         passes++;
+         loop();
+      }
+
+      /* The inputs up to the watchdog reset that ends this boot */
+      if (boot < resumes.size()) {
+         hostRunUntil(std::max(hostNow(), lastInput));
+         hostWatchdog();
+         output += hostSerialOutput();
+         std::string board = hostSaveBoard();
+         if (board.size() + output.size() > HANDOVER_BYTES - sizeof(Handover)) {
+            printf("%s#%d: too much serial output to reset\n", range.file, range.number);
+            return EXIT_ERROR;
+         }
+         handover->at      = hostNow();
+         handover->pind    = hostPortInput(0);
+         handover->pinc    = hostPortInput(A0);
+         handover->differs = differs;
+         handover->loops   = passes;
+         handover->board   = board.size();
+         handover->output  = output.size();
+         memcpy(handover->data, board.data(), board.size());
+         memcpy(handover->data + board.size(), output.data(), output.size());
+         return EXIT_RESET;
+      }
+
+      while (hostNow() < start + HOST_MS(RUN_LIMIT_MS)) {
+         loop();
+         hostAdvance(HOST_MS(1));
+      }
+   } catch (HostHalt &) {
+      halted = true;
+   }
+
+   std::string log = textOf(output + hostSerialOutput());
+   int saber = atoi(logField(log, "SABER INDEX: ").c_str());
+
+   /* Wrong saber pattern - ask for a run with micros() shifted onto it */
+   if ((rec.saber >= 0) && (saber != rec.saber) && (0 == hostConfig.microsOffset)) {
+      return EXIT_OFFSET + (rec.saber - saber + 10) % 10;
+   }
+
+   int  relay  = atoi(logField(log, "RELAY INDEX: ").c_str());
+   int  total  = atoi(logField(log, "FINAL SCORE: ").c_str());
+   bool same   = halted && rec.ended && !differs && (relay == rec.relay) &&
+                 ((rec.saber < 0) || (saber == rec.saber)) &&
+                 (stage2.score() == rec.stage2) && (stage3.score() == rec.stage3) &&
+                 (total == rec.total);
+
+   if (options.verbose) {
+      fputs(log.c_str(), stdout);
+   }
+   printf("%s#%d seed=%u relay=%d/%d saber=%d/%d stage2=%d/%d stage3=%d/%d total=%d/%d "
+          "loops=%zu%s%s%s%s %s\n",
+          range.file, range.number, rec.seed, rec.relay, relay, rec.saber, saber,
+          rec.stage2, stage2.score(), rec.stage3, stage3.score(), rec.total, total,
+          passes, resumes.empty() ? "" : (" resets=" + std::to_string(resumes.size())).c_str(),
+          differs ? " RESUME-DIFFERS" : "", rec.lost ? " LOST-RECORDS" : "",
+          halted ? "" : " TIMEOUT", same ? "OK" : "MISMATCH");
+   fflush(stdout);
+   return same ? EXIT_MATCHED : EXIT_MISMATCH;
+}
+
+/* Child: replay one match, print the comparison and exit with the result.
+ *    Each boot of a match that was reset runs in a child of its own.
+ */
+static int replay(const MatchRange &range, const Options &options, long offset)
+{
+   Recorded    rec = { 0, false, -1, -1, 0, 0, 0, false, 0 };
+   TraceRecord record;
+   bool        started = false;
+   std::vector<const uint8_t *> resumes;
+
+   /* First pass over the records - match configuration and results */
+   for (const uint8_t *p = range.begin; NULL != (p = nextRecord(p, range.end, record));
+        p += sizeof(record)) {
+      switch (record.type) {
+         case TRACE_START:   rec.seed = record.value;                             break;
+         case TRACE_MATCH:   rec.attached = record.data; started = true;          break;
+         case TRACE_RELAY:   rec.relay = record.data;                             break;
+         case TRACE_SABER:   rec.saber = record.data;                             break;
+         case TRACE_SCORE:   ((2 == record.data) ? rec.stage2 : rec.stage3) = (int16_t) record.value; break;
+         case TRACE_END:     rec.total = (int16_t) record.value; rec.ended = true; break;
+         case TRACE_LOST:    rec.lost += record.value;                            break;
+         case TRACE_RESUME:  resumes.push_back(p);                                break;
+      }
+   }
+   if (!started) {
+      printf("%s#%d: no match start in the trace\n", range.file, range.number);
+      return EXIT_ERROR;
+   }
+
+   hostConfig.lcdAttached    = rec.attached;
+   hostConfig.relayAttached  = true;
+   hostConfig.analogValue[1] = rec.seed;
+   hostConfig.microsOffset   = offset;
+
+   if (resumes.empty()) {
+      return replayBoot(range, options, rec, resumes, 0, NULL);
+   }
+
+   Handover *handover = (Handover *) mmap(NULL, HANDOVER_BYTES, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (MAP_FAILED == handover) {
+      perror("mmap");
+      return EXIT_ERROR;
+   }
+   for (size_t boot=0; ; boot++) {
+      int status;
+
+      fflush(stdout);
+      pid_t pid = fork();
+      if (0 == pid) {
+         _exit(replayBoot(range, options, rec, resumes, boot, handover));
+      }
+      if ((pid < 0) || (pid != waitpid(pid, &status, 0)) || !WIFEXITED(status)) {
+         return EXIT_ERROR;
+      }
+      if (EXIT_RESET != WEXITSTATUS(status)) {
+         return WEXITSTATUS(status);
+      }
+   }
+}
+
+static int runChild(const MatchRange &range, const Options &options, long offset)
+{
+   int status;
+
+   fflush(stdout);
+   pid_t pid = fork();
+   if (0 == pid) {
+      _exit(replay(range, options, offset));
+   }
+   if ((pid < 0) || (pid != waitpid(pid, &status, 0)) || !WIFEXITED(status)) {
+      return EXIT_ERROR;
+   }
+   return WEXITSTATUS(status);
+}
+
+int main(int argc, char **argv)
+{
+   Options options = { false, false, 0 };
+   std::vector<MatchRange> matches;
+   int opt;
+
+   while (-1 != (opt = getopt(argc, argv, "vrm:"))) {
+      switch (opt) {
+         case 'v': options.verbose  = true;          break;
+         case 'r': options.realTime = true;          break;
+         case 'm': options.only     = atoi(optarg);  break;
+         default:
+            fprintf(stderr, "usage: arenareplay [-v] [-r] [-m match] capture...\n");
+            return EXIT_ERROR;
+      }
+   }
+
+   for (int a=optind; a < argc; a++) {
+      int fd = open(argv[a], O_RDONLY);
+      struct stat st;
+
+      if ((fd < 0) || (0 != fstat(fd, &st))) {
+         perror(argv[a]);
+         return EXIT_ERROR;
+      }
+      if (0 == st.st_size) {
+         close(fd);
+         continue;
+      }
+      void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (MAP_FAILED == data) {
+         perror(argv[a]);
+         return EXIT_ERROR;
+      }
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      findMatches(argv[a], (const uint8_t *) data, st.st_size, matches);
+   }
+
+   double started = wallSeconds();
+   int    replayed = 0, mismatched = 0;
+
+   for (size_t m=0; m < matches.size(); m++) {
+      if (options.only && ((int) m + 1 != options.only)) {
+         continue;
+      }
+      int result = runChild(matches[m], options, 0);
+      if (result >= EXIT_OFFSET) {
+         result = runChild(matches[m], options, result - EXIT_OFFSET);
+      }
+      replayed++;
+      mismatched += (EXIT_MATCHED != result) ? 1 : 0;
+   }
+
+   fprintf(stderr, "%d matches replayed in %.2fs, %d mismatched\n",
+           replayed, wallSeconds() - started, mismatched);
+   return mismatched ? EXIT_MISMATCH : EXIT_MATCHED;
+}
@@ -0,0 +1,337 @@
+/*
+ * Re-score archived match logs with the current scoring rules
+ *
+ * Reads the serial logs of past matches (any number of matches per
+ *    file, with or without the binary input trace records of Trace.h
+ *    mixed in) and scores each match again from its report lines with
+ *    the scoring code the sketch uses (Scoring.cpp): stage 2 from the
+ *    HIT REPORT, stage 3 from the Digits entered and the turn pattern
+ *    of the RELAY INDEX. Matches whose new scores differ from the
+ *    logged STAGE SCORE and FINAL SCORE lines are printed, one line each:
+ *
+ *    <file>#<match> seed=<n> relay=<n> stage2=<old>/<new> stage3=<old>/<new>
+ *       total=<old>/<new> (<change>)
+ *
+ * The logs are memory mapped and tokenized in place - a line is a
+ *    pointer and length into the mapping and nothing is copied. Files
+ *    are shared out to worker processes, one per core by default, which
+ *    take the next file from a shared counter. Each worker writes its
+ *    lines to its own temporary file and the parent prints them in the
+ *    order of the files given, so the output does not depend on the
+ *    number of workers.
+ *
+ * Usage: arenarescore [-a] [-j workers] log...
+ *    -a  print every match, not only the changed ones
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <vector>
+
+#include <avr/pgmspace.h>
+
+#include "Scoring.h"
+#include "relayTable.h"
+
+#define TRACE_RECORD_BYTES  8       // sizeof(TraceRecord), see Trace.h
+
+/* A piece of a mapped log */
+struct Span {
+   const char *p;
+   size_t      n;
+
+   bool startsWith(const char *key, Span &rest) const {
+      size_t length = strlen(key);
+      if ((n < length) || (0 != memcmp(p, key, length))) {
+         return false;
+      }
+      rest.p = p + length;
+      rest.n = n - length;
+      return true;
+   }
+   long number(void) const {
+      long value = 0;
+      bool negative = (n > 0) && ('-' == p[0]);
+      for (size_t i=negative ? 1 : 0; (i < n) && (p[i] >= '0') && (p[i] <= '9'); i++) {
+         value = value * 10 + (p[i] - '0');
+      }
+      return negative ? -value : value;
+   }
+};
+
+/* What one match logged */
+struct Logged {
+   long seed;
+   long relay;
+   long stage2;
+   long stage3;
+   long total;
+   Span hits;
+   Span digits;
+   int  section;                // stage report being read, 0 before any
+};
+
+/* Per file results, written by the worker that read the file */
+struct FileResult {
+   int    worker;
+   long   offset;               // of its lines in the worker's output
+   long   length;
+   long   matches;
+   long   changed;
+   long   oldTotal;
+   long   newTotal;
+   size_t bytes;
+   bool   failed;
+};
+
+struct Shared {
+   long       next;             // next file to read
+   FileResult files[1];         // one per file
+};
+
+static double wallSeconds(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Next text line - binary trace records (a byte with the high bit set
+ *    and the 7 after it) end a line, and are skipped
+ */
+static bool nextLine(const char *&p, const char *end, Span &line)
+{
+   while ((p < end) && (*p & 0x80)) {
+      p += std::min<size_t>(TRACE_RECORD_BYTES, end - p);
+   }
+   if (p >= end) {
+      return false;
+   }
+   line.p = p;
+   while ((p < end) && ('\n' != *p) && !(*p & 0x80)) {
+      p++;
+   }
+   line.n = p - line.p;
+   if ((line.n > 0) && ('\r' == line.p[line.n - 1])) {
+      line.n--;
+   }
+   if ((p < end) && ('\n' == *p)) {
+      p++;
+   }
+   return true;
+}
+
+/* Score one logged match again and print it if asked to */
+static void rescore(const Logged &logged, const char *file, FileResult &result, bool all, FILE *out)
+{
+   uint16_t pattern = 0;
+   int      stage2, stage3, total;
+   bool     known = (logged.relay >= 0) && ((size_t) logged.relay < RELAY_TABLE_LENGTH);
+
+   if (known) {
+      pattern = pgm_read_word_near((relayTable[logged.relay]) + 1);
+   }
+
+   /* "--none--" scores as no digits */
+   Span digits = logged.digits;
+   if ((digits.n > 0) && ('-' == digits.p[0])) {
+      digits.n = 0;
+   }
+
+   stage2 = stage2Score(logged.hits.p, (uint8_t) std::min<size_t>(logged.hits.n, 255));
+   stage3 = known ? stage3Score(digits.p, (uint8_t) std::min<size_t>(digits.n, 255), pattern) : 0;
+   total  = stage2 + stage3;
+
+   result.matches++;
+   result.oldTotal += logged.total;
+   result.newTotal += total;
+
+   bool changed = (stage2 != logged.stage2) || (stage3 != logged.stage3) || (total != logged.total);
+   result.changed += changed ? 1 : 0;
+   if (changed || all) {
+      fprintf(out, "%s#%ld seed=%ld relay=%ld stage2=%ld/%d stage3=%ld/%d total=%ld/%d (%+ld)%s\n",
+              file, result.matches, logged.seed, logged.relay, logged.stage2, stage2,
+              logged.stage3, stage3, logged.total, total, total - logged.total,
+              known ? "" : " UNKNOWN-RELAY");
+   }
+}
+
+/* Read the matches of one mapped log */
+static void scanLog(const char *file, const char *data, size_t size, FileResult &result,
+                    bool all, FILE *out)
+{
+   const char *p = data, *end = data + size;
+   Logged      logged;
+   bool        open = false;
+   Span        line, rest;
+
+   while (nextLine(p, end, line)) {
+      if (line.startsWith("------ RESULTS ------", rest)) {
+         memset(&logged, 0, sizeof(logged));
+         logged.relay = -1;
+         open = true;
+      } else if (!open) {
+         continue;
+      } else if (line.startsWith("FINAL SCORE: ", rest)) {
+         logged.total = rest.number();
+      } else if (line.startsWith("RANDOM SEED: ", rest)) {
+         logged.seed = rest.number();
+      } else if (line.startsWith("------ Stage ", rest)) {
+         logged.section = (int) rest.number();
+      } else if (line.startsWith("RELAY INDEX: ", rest)) {
+         logged.relay = rest.number();
+      } else if (line.startsWith("HIT REPORT : [", rest)) {
+         logged.hits = rest;
+         logged.hits.n = (const char *) memchr(rest.p, ']', rest.n) ?
+                         (const char *) memchr(rest.p, ']', rest.n) - rest.p : rest.n;
+      } else if (line.startsWith("STAGE SCORE: ", rest)) {
+         if (2 == logged.section) {
+            logged.stage2 = rest.number();
+         } else if (3 == logged.section) {
+            logged.stage3 = rest.number();
+         }
+      } else if (line.startsWith("Digits entered: ", rest)) {
+         logged.digits = rest;
+         rescore(logged, file, result, all, out);
+         open = false;
+      }
+   }
+}
+
+/* Worker: take files from the shared counter until there are none left */
+static void work(Shared *shared, int worker, char **files, long count, bool all, FILE *out)
+{
+   for (;;) {
+      long f = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED);
+      if (f >= count) {
+         break;
+      }
+
+      FileResult &result = shared->files[f];
+      int fd = open(files[f], O_RDONLY);
+      struct stat st;
+
+      result.worker = worker;
+      result.offset = ftell(out);
+      if ((fd < 0) || (0 != fstat(fd, &st))) {
+         perror(files[f]);
+         result.failed = true;
+         if (fd >= 0) {
+            close(fd);
+         }
+         continue;
+      }
+      if (st.st_size > 0) {
+         void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (MAP_FAILED == data) {
+            perror(files[f]);
+            result.failed = true;
+         } else {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            scanLog(files[f], (const char *) data, st.st_size, result, all, out);
+            munmap(data, st.st_size);
+         }
+      }
+      close(fd);
+      result.bytes  = st.st_size;
+      result.length = ftell(out) - result.offset;
+   }
+   fflush(out);
+}
+
+int main(int argc, char **argv)
+{
+   bool all = false;
+   int  workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+   int  opt;
+
+   while (-1 != (opt = getopt(argc, argv, "aj:"))) {
+      switch (opt) {
+         case 'a': all     = true;             break;
+         case 'j': workers = atoi(optarg);     break;
+         default:
+            fprintf(stderr, "usage: arenarescore [-a] [-j workers] log...\n");
+            return 2;
+      }
+   }
+
+   long   count = argc - optind;
+   char **files = argv + optind;
+   if ((count < 1) || (workers < 1)) {
+      fprintf(stderr, "usage: arenarescore [-a] [-j workers] log...\n");
+      return 2;
+   }
+   workers = (int) std::min<long>(workers, count);
+
+   size_t  size = sizeof(Shared) + (count - 1) * sizeof(FileResult);
+   Shared *shared = (Shared *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (MAP_FAILED == shared) {
+      perror("mmap");
+      return 2;
+   }
+
+   std::vector<FILE *> outputs(workers);
+   for (int w=0; w < workers; w++) {
+      if (NULL == (outputs[w] = tmpfile())) {
+         perror("tmpfile");
+         return 2;
+      }
+   }
+
+   double started = wallSeconds();
+
+   fflush(stdout);
+   for (int w=0; w < workers; w++) {
+      if (0 == fork()) {
+         work(shared, w, files, count, all, outputs[w]);
+         _exit(0);
+      }
+   }
+   while (wait(NULL) > 0) {
+   }
+   double elapsed = wallSeconds() - started;
+
+   /* The lines of each file, in the order given */
+   long   matches = 0, changed = 0, oldTotal = 0, newTotal = 0, failed = 0;
+   size_t bytes = 0;
+   char   buffer[65536];
+
+   for (long f=0; f < count; f++) {
+      const FileResult &result = shared->files[f];
+      FILE *out = outputs[result.worker];
+
+      fseek(out, result.offset, SEEK_SET);
+      for (long left = result.length; left > 0; ) {
+         size_t got = fread(buffer, 1, std::min<long>(left, sizeof(buffer)), out);
+         if (0 == got) {
+            break;
+         }
+         fwrite(buffer, 1, got, stdout);
+         left -= got;
+      }
+      matches  += result.matches;
+      changed  += result.changed;
+      oldTotal += result.oldTotal;
+      newTotal += result.newTotal;
+      bytes    += result.bytes;
+      failed   += result.failed ? 1 : 0;
+   }
+   fflush(stdout);
+
+   fprintf(stderr, "%ld files (%.1f MB), %ld matches, %ld changed, total points %ld -> %ld, "
+                   "%.2fs (%.0f MB/s) with %d workers%s\n",
+           count, bytes / 1e6, matches, changed, oldTotal, newTotal, elapsed,
+           elapsed > 0 ? bytes / 1e6 / elapsed : 0.0, workers,
+           failed ? ", some files unreadable" : "");
+   munmap(shared, size);
+   return failed ? 2 : (changed ? 1 : 0);
+}
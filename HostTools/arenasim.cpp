@@ -0,0 +1,471 @@
+/*
+ * Run the ArenaControl sketch on the host, faster than real time
+ *
+ * The unchanged sketch and stage code are built against the host stand-in
+ *    for the Arduino core in HostCore/, which runs them on a virtual clock
+ *    with emulated relay and LCD expanders and NeoPixel stick. A script
+ *    drives the inputs (START/STOP buttons, vibration sensor hits, knob
+ *    turns, serial input) at given virtual times, and one summary line is
+ *    printed per match.
+ *
+ * Each match runs in a forked child, so every match starts from the
+ *    sketch's power-on state of its globals. A reset in a script ends
+ *    the child running the sketch, and a new one forked from the same
+ *    power-on state picks up the board as the reset left it - the
+ *    devices, the .noinit variables and the clock - so the sketch can
+ *    resume the match from its checkpoint (see Checkpoint.h).
+ *
+ * Script lines (# starts a comment):
+ *
+ *    seed <n>                   A1 reading, the random seed (default 0)
+ *    lcd on|off                 controller box attached (default on)
+ *    relay on|off               relay board attached (default on)
+ *    limit <ms>                 give up at this virtual time (default 300000)
+ *
+ *    <ms> press start|stop [hold ms]     button held for 200ms by default
+ *    <ms> hit [count] [spacing ms]       vibration sensor hits
+ *    <ms> turn <revolutions> <ms>        knob turn, negative is counter
+ *                                        clockwise, edges evenly spaced
+ *    <ms> serial <text>                  a line arrives on the serial port
+ *    <ms> reset                          the watchdog resets the arena at
+ *                                        the next loop() pass of the match
+ *
+ *    Times are milliseconds of virtual time since reset. With the LCD
+ *    attached the sketch waits for START, and setting up the LCD takes
+ *    about 1.1 seconds, so press START after that.
+ *
+ * Usage: arenasim [-v] [-l] [-q loop us] [-n runs] [-s seed] [-o file] [-p file [-w ms:ms]]
+ *                 script...
+ *    -v  copy the sketch serial output to stdout
+ *    -l  print the LCD contents at the end of each match
+ *    -q  virtual time for one pass of loop() apart from the waits the
+ *        core models (I2C, serial, NeoPixel), default 1000us
+ *    -n  run each script n times, adding 0, 1, ... to the seed
+ *    -s  seed to use instead of the one in the script
+ *    -o  append the raw serial output of each match to a file, which
+ *        holds the input trace of the match (see arenareplay)
+ *    -p  append the pin level changes of each match to a file, for
+ *        HostTools/pinvcd - with the timing trace on D11/D12 (see
+ *        PinTrace.h). A whole match is about 50MB of changes. The
+ *        trace takes virtual time, as it takes cycles on the arena, so
+ *        a traced match can turn out differently from an untraced one.
+ *    -w  only trace the pins from one virtual time to another (ms),
+ *        to the nearest loop() pass
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#include "HostCore.h"
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "QuadratureTable.h"
+#include "Quadrature.h"
+#include "Stage1.h"
+#include "Stage2.h"
+#include "Stage3.h"
+
+#define VIBRATE_PIN     2
+#define START_PIN       A0
+#define STOP_PIN        A3
+
+#define HIT_PULSE_MS    2       // sensor contact closure per hit
+
+#define BOOT_RESET      3       // exit status of a boot the script reset
+#define HANDOVER_BYTES  (16 << 20)
+
+/* The sketch */
+void setup(void);
+void loop(void);
+extern Stage1 stage1;
+extern Stage2 stage2;
+extern Stage3 stage3;
+
+/* Clockwise order of the encoder pin states (A in bit 0, B in bit 1), the
+ *    same order as in QuadModel.h - the rest position is the first
+ */
+static const uint8_t clockwiseOrder[4] = { 3, 1, 0, 2 };
+
+struct Options {
+   bool     verbose;
+   bool     showLcd;
+   uint32_t loopUs;
+   long     runs;
+   long     seed;               // -1 to use the script seed
+   const char *capture;         // raw serial output file, or NULL
+   const char *pinTrace;        // pin trace file, or NULL
+   long     traceFrom;          // ms, the window of the pin trace
+   long     traceTo;            // -1 for the end of the match
+};
+
+struct Match {
+   const char *script;
+   long        seed;
+   long        run;             // added to the seed
+   long        limitMs;
+   int         phase;           // encoder position in clockwiseOrder
+   std::vector<long> resets;    // ms
+};
+
+/* Shared with the boots of a match that is reset: the board as the last
+ *    reset left it, then the serial output of the boots so far
+ */
+struct Handover {
+   uint64_t at;                 // virtual time of the reset
+   size_t   board;
+   size_t   log;
+   char     data[1];
+};
+
+static double wallMs(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+static void fail(const char *script, int line, const char *text)
+{
+   fprintf(stderr, "%s:%d: can't parse '%s'\n", script, line, text);
+   exit(2);
+}
+
+static void drivePulse(uint64_t at, uint8_t pin, uint64_t hold)
+{
+   hostDrivePin(at, pin, LOW);
+   hostDrivePin(at + hold, pin, HIGH);
+}
+
+/* Schedule the evenly spaced quadrature transitions of a knob turn */
+static void driveTurn(Match &match, uint64_t at, double revolutions, double ms)
+{
+   long transitions = (long) (revolutions * QUADRATURE_CYCLES * 4 + (revolutions < 0 ? -0.5 : 0.5));
+   int  direction = (transitions < 0) ? 3 : 1;
+   long count = labs(transitions);
+
+   for (long n=1; n <= count; n++) {
+      uint64_t when = at + (uint64_t) (HOST_MS(ms) * n / count);
+      uint8_t  was  = clockwiseOrder[match.phase];
+
+      match.phase = (match.phase + direction) & 3;
+      uint8_t pins = clockwiseOrder[match.phase];
+      if ((was ^ pins) & 1) {
+         hostDrivePin(when, ENCODER_A_PIN, pins & 1);
+      }
+      if ((was ^ pins) & 2) {
+         hostDrivePin(when, ENCODER_B_PIN, (pins >> 1) & 1);
+      }
+   }
+}
+
+/* Read the script, configuring the board and scheduling its inputs */
+static void loadScript(Match &match, long seedOverride)
+{
+   FILE *fp = fopen(match.script, "r");
+   char  text[256];
+   int   line = 0;
+
+   if (NULL == fp) {
+      perror(match.script);
+      exit(2);
+   }
+
+   match.seed = 0;
+   match.limitMs = 300000;
+   match.phase = 0;
+   match.resets.clear();
+
+   while (fgets(text, sizeof(text), fp)) {
+      char   *hash = strchr(text, '#');
+      char    word[32] = "", arg[32] = "";
+      double  ms, a = 0, b = 0;
+      int     used = 0;
+
+      line++;
+      if (hash) {
+         *hash = '\0';
+      }
+      text[strcspn(text, "\r\n")] = '\0';
+
+      if (1 == sscanf(text, " %31s", word) && !isdigit((unsigned char) word[0])) {
+         if (2 != sscanf(text, " %31s %31s", word, arg)) {
+            fail(match.script, line, text);
+         }
+         if (0 == strcmp(word, "seed")) {
+            match.seed = atol(arg);
+         } else if (0 == strcmp(word, "lcd")) {
+            hostConfig.lcdAttached = (0 == strcmp(arg, "on"));
+         } else if (0 == strcmp(word, "relay")) {
+            hostConfig.relayAttached = (0 == strcmp(arg, "on"));
+         } else if (0 == strcmp(word, "limit")) {
+            match.limitMs = atol(arg);
+         } else {
+            fail(match.script, line, text);
+         }
+         continue;
+      }
+      if (2 > sscanf(text, " %lf %31s %n", &ms, word, &used)) {
+         if (strspn(text, " \t") != strlen(text)) {
+            fail(match.script, line, text);
+         }
+         continue;
+      }
+
+      uint64_t at = HOST_MS(ms);
+      const char *rest = text + used;
+
+      if (0 == strcmp(word, "press")) {
+         b = 200;
+         if (1 > sscanf(rest, "%31s %lf", arg, &b)) {
+            fail(match.script, line, text);
+         }
+         drivePulse(at, (0 == strcmp(arg, "stop")) ? STOP_PIN : START_PIN, HOST_MS(b));
+      } else if (0 == strcmp(word, "hit")) {
+         a = 1;
+         b = 100;
+         sscanf(rest, "%lf %lf", &a, &b);
+         for (long n=0; n < (long) a; n++) {
+            drivePulse(at + (uint64_t) (HOST_MS(b) * n), VIBRATE_PIN, HOST_MS(HIT_PULSE_MS));
+         }
+      } else if (0 == strcmp(word, "turn")) {
+         if (2 != sscanf(rest, "%lf %lf", &a, &b)) {
+            fail(match.script, line, text);
+         }
+         driveTurn(match, at, a, b);
+      } else if (0 == strcmp(word, "serial")) {
+         hostSerialInput(at, (std::string(rest) + "\n").c_str());
+      } else if (0 == strcmp(word, "reset")) {
+         match.resets.push_back((long) ms);
+      } else {
+         fail(match.script, line, text);
+      }
+   }
+   fclose(fp);
+
+   match.seed = ((seedOverride >= 0) ? seedOverride : match.seed) + match.run;
+}
+
+/* Rest of the report line after 'key' in the serial log */
+static std::string logField(const std::string &log, const char *key)
+{
+   size_t start = log.rfind(key);
+
+   if (std::string::npos == start) {
+      return "?";
+   }
+   start += strlen(key);
+   return log.substr(start, log.find_first_of("\r\n]", start) - start);
+}
+
+/* Pin trace on inside the window, off outside it */
+static void traceWindow(FILE *trace, const Options &options, bool &tracing)
+{
+   bool inside = trace && (hostNow() >= HOST_MS(options.traceFrom)) &&
+                 ((options.traceTo < 0) || (hostNow() < HOST_MS(options.traceTo)));
+
+   if (inside != tracing) {
+      hostPinTrace(inside ? trace : NULL);
+      tracing = inside;
+   }
+}
+
+/* Run the sketch from one reset to the next (or to the end of the match),
+ *    and print the summary line if it is the last
+ */
+static int runBoot(Match &match, const Options &options, size_t boot, double started,
+                   Handover *handover)
+{
+   uint64_t    resetAt = (boot < match.resets.size()) ? HOST_MS(match.resets[boot]) : ~0ULL;
+   bool        halted = false, reset = false, tracing = false;
+   std::string log;
+   FILE       *trace = NULL;
+
+   if (boot > 0) {
+      hostLoadBoard(std::string(handover->data, handover->board), handover->at);
+      log.assign(handover->data + handover->board, handover->log);
+   }
+
+   /* The boots of a match run one after the other, so each appends to
+    *    the pin trace in turn
+    */
+   if (options.pinTrace) {
+      trace = fopen(options.pinTrace, "a");
+      if (NULL == trace) {
+         perror(options.pinTrace);
+         return 2;
+      }
+      fprintf(trace, "# %s %s seed=%ld\n", boot ? "reset" : "match", match.script, match.seed);
+   }
+
+   try {
+      traceWindow(trace, options, tracing);
+      setup();
+      while (hostNow() < HOST_MS(match.limitMs)) {
+         if (hostNow() >= resetAt) {
+            reset = true;
+            break;
+         }
+         traceWindow(trace, options, tracing);
+         loop();
+         hostAdvance(HOST_US(options.loopUs));
+      }
+   } catch (HostHalt &) {
+      halted = true;
+   }
+   log += hostSerialOutput();
+
+   if (trace) {
+      hostPinTrace(NULL);
+      fclose(trace);
+   }
+
+   if (reset) {
+      hostWatchdog();
+      std::string board = hostSaveBoard();
+      if (board.size() + log.size() > HANDOVER_BYTES - sizeof(Handover)) {
+         fprintf(stderr, "%s: too much serial output to reset\n", match.script);
+         return 2;
+      }
+      handover->at    = hostNow();
+      handover->board = board.size();
+      handover->log   = log.size();
+      memcpy(handover->data, board.data(), board.size());
+      memcpy(handover->data + board.size(), log.data(), log.size());
+      return BOOT_RESET;
+   }
+
+   /* One write per match, so matches from parallel runs never interleave */
+   if (options.capture) {
+      int fd = open(options.capture, O_WRONLY | O_CREAT | O_APPEND, 0644);
+      if ((fd < 0) || ((ssize_t) log.size() != write(fd, log.data(), log.size()))) {
+         perror(options.capture);
+         return 2;
+      }
+      close(fd);
+   }
+
+   fflush(stdout);
+   printf("%s seed=%ld relay=%s saber=%s hits=[%s] stage2=%d stage3=%d total=%s digits=%s "
+          "vtime=%.1fs wall=%.1fms%s%s\n",
+          match.script, match.seed,
+          logField(log, "RELAY INDEX: ").c_str(), logField(log, "SABER INDEX: ").c_str(),
+          logField(log, "HIT REPORT : [").c_str(), stage2.score(), stage3.score(),
+          logField(log, "FINAL SCORE: ").c_str(), logField(log, "Digits entered: ").c_str(),
+          hostNow() / 1e9, wallMs() - started, halted ? "" : " TIMEOUT",
+          boot ? (" resets=" + std::to_string(boot)).c_str() : "");
+
+   if (options.showLcd) {
+      for (uint8_t row=0; row < 4; row++) {
+         printf("   |%s|\n", hostLcdLine(row).c_str());
+      }
+   }
+   printf("   isr=%llu deferred=%llu i2c=%llu (%.1fs) serial=%llu (blocked %.1fs) shows=%llu sleeps=%llu (%.1fs)\n",
+          (unsigned long long) hostStats.isrCalls, (unsigned long long) hostStats.deferredIsrs,
+          (unsigned long long) hostStats.i2cTransfers, hostStats.i2cTime / 1e9,
+          (unsigned long long) hostStats.serialBytes, hostStats.serialBlocked / 1e9,
+          (unsigned long long) hostStats.pixelShows,
+          (unsigned long long) hostStats.sleeps, hostStats.sleepTime / 1e9);
+   fflush(stdout);
+   return halted ? 0 : 1;
+}
+
+/* Child: run one match and print its summary line. Each boot of a match
+ *    the script resets runs in a child of its own.
+ */
+static int runMatch(Match &match, const Options &options)
+{
+   double started = wallMs();
+
+   hostConfig.echoSerial = options.verbose;
+   loadScript(match, options.seed);
+   hostConfig.analogValue[1] = match.seed;
+
+   if (match.resets.empty()) {
+      return runBoot(match, options, 0, started, NULL);
+   }
+
+   Handover *handover = (Handover *) mmap(NULL, HANDOVER_BYTES, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (MAP_FAILED == handover) {
+      perror("mmap");
+      return 2;
+   }
+   for (size_t boot=0; ; boot++) {
+      int status;
+
+      fflush(stdout);
+      pid_t pid = fork();
+      if (0 == pid) {
+         _exit(runBoot(match, options, boot, started, handover));
+      }
+      if ((pid < 0) || (pid != waitpid(pid, &status, 0)) || !WIFEXITED(status)) {
+         return 2;
+      }
+      if (BOOT_RESET != WEXITSTATUS(status)) {
+         return WEXITSTATUS(status);
+      }
+   }
+}
+
+int main(int argc, char **argv)
+{
+   Options options = { false, false, 1000, 1, -1, NULL, NULL, 0, -1 };
+   int     opt;
+   int     failed = 0;
+   double  started = wallMs();
+   long    matches = 0;
+
+   while (-1 != (opt = getopt(argc, argv, "vlq:n:s:o:p:w:"))) {
+      switch (opt) {
+         case 'v': options.verbose = true;            break;
+         case 'l': options.showLcd = true;            break;
+         case 'q': options.loopUs  = atol(optarg);    break;
+         case 'n': options.runs    = atol(optarg);    break;
+         case 's': options.seed    = atol(optarg);    break;
+         case 'o': options.capture = optarg;          break;
+         case 'p': options.pinTrace = optarg;         break;
+         case 'w':
+            if (2 != sscanf(optarg, "%ld:%ld", &options.traceFrom, &options.traceTo)) {
+               fprintf(stderr, "arenasim: -w wants from:to in ms\n");
+               return 2;
+            }
+            break;
+         default:
+            fprintf(stderr, "usage: arenasim [-v] [-l] [-q loop us] [-n runs] [-s seed] [-o file] "
+                            "[-p file [-w ms:ms]] script...\n");
+            return 2;
+      }
+   }
+
+   for (int a=optind; a < argc; a++) {
+      for (long run=0; run < options.runs; run++) {
+         Match match = { argv[a], 0, run, 0, 0 };
+         int status;
+
+         fflush(stdout);
+         pid_t pid = fork();
+         if (0 == pid) {
+            _exit(runMatch(match, options));
+         }
+         if ((pid < 0) || (pid != waitpid(pid, &status, 0)) ||
+             !WIFEXITED(status) || (0 != WEXITSTATUS(status))) {
+            failed++;
+         }
+         matches++;
+      }
+   }
+
+   double elapsed = wallMs() - started;
+   fprintf(stderr, "%ld matches in %.2fs (%.1f ms/match), %d failed\n",
+           matches, elapsed / 1e3, matches ? elapsed / matches : 0.0, failed);
+   return failed ? 1 : 0;
+}
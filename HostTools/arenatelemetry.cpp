@@ -0,0 +1,201 @@
+/*
+ * Record arena telemetry frames as time series files
+ *
+ * Reads serial captures from an arena built with TELEMETRY_HZ (or from
+ *    arenasim -o), takes the telemetry frames of Telemetry.h out of the
+ *    text log and input trace records they are mixed with, and writes
+ *    each match as one CSV file, a row per frame, to plot with anything
+ *    that reads CSV (gnuplot, a spreadsheet, pandas). A new match starts
+ *    at a MATCH record of the input trace, or, in a capture without the
+ *    trace, where the match time goes back more than a second. A match
+ *    resumed from a checkpoint goes back at most a checkpoint period,
+ *    so it stays one file.
+ *
+ * The capture is read as a stream, and each row is written as its frame
+ *    comes in, so the arena's serial port can be recorded live:
+ *
+ *       stty -F /dev/ttyACM0 raw 9600
+ *       arenatelemetry -o arena3 - < /dev/ttyACM0
+ *
+ * Columns: match time (ms), lightsaber state (number and name), encoder
+ *    count (low 16 bits), vibration edges pending, lightsaber red, green
+ *    and blue (0-255, from RGB 3-3-2), the knob LED pins (enable, red,
+ *    green and blue - all active low), loop() passes since the frame
+ *    before and the rate they make, and what the frame before took to
+ *    send. A summary line per match goes to stdout.
+ *
+ * Usage: arenatelemetry [-o prefix] capture...
+ *    -o  output files are <prefix>-<n>.csv, n counting matches from 1
+ *        across the captures (default "telemetry")
+ *    -   as a capture reads stdin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include "Telemetry.h"
+#include "Trace.h"
+
+#define RECORD_BYTES   8        // sizeof(TraceRecord)
+#define MATCH_BACK_MS  1000     // match time going back this far is a new match
+
+/* enum states, in Stage2.cpp */
+static const char *stateNames[] = {
+   "INITIAL", "COUNTDOWN_1", "COUNTDOWN_2", "COUNTDOWN_3", "START", "WAITING",
+   "FIELD_OFF_NEUTRAL", "FIELD_OFF", "FIELD_ON", "STOPPED"
+};
+
+/* The match being written */
+struct Recorder {
+   std::string prefix;
+   int         match;           // matches so far
+   FILE       *out;
+   std::string path;
+   long        frames;
+   uint32_t    first;           // match time of the first frame
+   uint32_t    last;            // and of the last one
+   uint32_t    gap;             // longest time between frames
+   uint16_t    costMax;         // us
+};
+
+static void endMatch(Recorder &rec)
+{
+   if (NULL == rec.out) {
+      return;
+   }
+   fclose(rec.out);
+   rec.out = NULL;
+   printf("%s: %ld frames, %.1fs to %.1fs, longest gap %u ms, longest frame %u us\n",
+          rec.path.c_str(), rec.frames, rec.first / 1000.0, rec.last / 1000.0,
+          rec.gap, rec.costMax);
+}
+
+static bool startMatch(Recorder &rec, uint32_t matchTime)
+{
+   endMatch(rec);
+
+   rec.path = rec.prefix + "-" + std::to_string(++rec.match) + ".csv";
+   rec.out = fopen(rec.path.c_str(), "w");
+   if (NULL == rec.out) {
+      perror(rec.path.c_str());
+      return false;
+   }
+   fprintf(rec.out, "time_ms,state,state_name,encoder,hits,saber_r,saber_g,saber_b,"
+                    "led_enable,led_red,led_green,led_blue,loops,loop_hz,cost_us\n");
+   rec.frames = 0;
+   rec.first = matchTime;
+   rec.last = matchTime;
+   rec.gap = 0;
+   rec.costMax = 0;
+   return true;
+}
+
+static bool frame(Recorder &rec, const TelemetryFrame &f)
+{
+   if ((NULL == rec.out) || (f.matchTime + MATCH_BACK_MS < rec.last)) {
+      if (!startMatch(rec, f.matchTime)) {
+         return false;
+      }
+   }
+
+   /* Back to a checkpoint after a reset counts as no time */
+   uint32_t span = (f.matchTime > rec.last) ? f.matchTime - rec.last : 0;
+   if (rec.frames && (span > rec.gap)) {
+      rec.gap = span;
+   }
+   if (f.cost > rec.costMax) {
+      rec.costMax = f.cost;
+   }
+
+   /* 3 bit red and green, 2 bit blue, scaled back up to 0-255 */
+   int red   = ((f.saber >> 5) & 0x07) * 255 / 7;
+   int green = ((f.saber >> 2) & 0x07) * 255 / 7;
+   int blue  = (f.saber & 0x03) * 255 / 3;
+
+   fprintf(rec.out, "%u,%u,%s,%d,%u,%d,%d,%d,%u,%u,%u,%u,%u,%.0f,%u\n",
+           f.matchTime, f.state,
+           (f.state < sizeof(stateNames) / sizeof(stateNames[0])) ? stateNames[f.state] : "?",
+           f.encoder, f.hits, red, green, blue,
+           f.leds & 0x01, (f.leds >> 1) & 0x01, (f.leds >> 2) & 0x01, (f.leds >> 3) & 0x01,
+           f.loops, (rec.frames && span) ? f.loops * 1000.0 / span : 0.0, f.cost);
+   fflush(rec.out);
+
+   rec.frames++;
+   rec.last = f.matchTime;
+   return true;
+}
+
+/* Text bytes are ASCII, a byte with the high bit set starts an 8 byte
+ *    record, and a frame is a TELEMETRY_FRAME record followed by a
+ *    TELEMETRY_MORE one. A MATCH record ends the match before it.
+ */
+static bool readCapture(FILE *in, Recorder &rec)
+{
+   uint8_t bytes[sizeof(TelemetryFrame)];
+   size_t  have = 0;
+   int     c;
+
+   while (EOF != (c = getc(in))) {
+      if ((0 == have) && !(c & 0x80)) {
+         continue;
+      }
+      bytes[have++] = c;
+
+      if ((RECORD_BYTES == have) && (TELEMETRY_FRAME != bytes[0])) {
+         if (TRACE_MATCH == bytes[0]) {
+            endMatch(rec);
+         }
+         have = 0;
+      } else if (sizeof(bytes) == have) {
+         have = 0;
+         if (TELEMETRY_MORE == bytes[RECORD_BYTES]) {
+            TelemetryFrame f;
+            memcpy(&f, bytes, sizeof(f));
+            if (!frame(rec, f)) {
+               return false;
+            }
+         }
+      }
+   }
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   Recorder rec = { "telemetry", 0, NULL, "", 0, 0, 0, 0, 0 };
+   int      opt;
+
+   while (-1 != (opt = getopt(argc, argv, "o:"))) {
+      switch (opt) {
+         case 'o': rec.prefix = optarg;  break;
+         default:
+            fprintf(stderr, "usage: arenatelemetry [-o prefix] capture...\n");
+            return 2;
+      }
+   }
+   if (optind >= argc) {
+      fprintf(stderr, "usage: arenatelemetry [-o prefix] capture...\n");
+      return 2;
+   }
+
+   for (int a=optind; a < argc; a++) {
+      FILE *in = strcmp(argv[a], "-") ? fopen(argv[a], "rb") : stdin;
+
+      if (NULL == in) {
+         perror(argv[a]);
+         return 2;
+      }
+      bool ok = readCapture(in, rec);
+      if (stdin != in) {
+         fclose(in);
+      }
+      if (!ok) {
+         return 2;
+      }
+   }
+   endMatch(rec);
+   return 0;
+}
@@ -0,0 +1,461 @@
+/*
+ * Rehearse a whole tournament on the host
+ *
+ * Runs every match of an event - each team once per heat, the teams of a
+ *    heat spread over the arenas - through the unchanged sketch on the
+ *    host core, then prints the team standings and the score distribution
+ *    for each relay pattern (which sets the stage 3 combination) and each
+ *    stage 2 fighting pattern.
+ *
+ * Robots are input generators driven from the match loop. Each team has
+ *    a model: how often it identifies the stage 1 components (and so
+ *    knows the combination), when it reaches the saber, how often it
+ *    swings and whether it waits for the field, and how fast and how
+ *    accurately it turns the knob. Models are randomised from the seed,
+ *    or read from a teams file, one team per line:
+ *
+ *    <name> <detect> <arrive ms> <swing ms> <discipline> <revs/s> <dial error>
+ *
+ *    detect      chance of knowing the combination (else digits guessed)
+ *    arrive      match time of the first saber hit (starts the duel)
+ *    swing       mean time between swings during the duel
+ *    discipline  chance a swing waits for the field to be on
+ *    revs/s      knob speed
+ *    dial error  chance each digit is dialed one turn off
+ *
+ * Every match runs in its own forked child, so it starts from the
+ *    power-on state of the sketch globals. Worker processes, one per core
+ *    by default, take the next match from a counter shared with the other
+ *    workers until none are left, and the children write their results
+ *    straight into a shared table. Nothing is attached to the controller
+ *    port, so a match starts at reset and runs the full match time.
+ *
+ * A loop() pass with nothing due in any stage (StageList idle()) skips
+ *    the virtual clock to the next input, stage deadline or robot move,
+ *    as the arena would sleep through it. A match then costs about 2ms
+ *    of one core (10ms stepping every pass), so 100k matches are about
+ *    3.5 core-minutes - seconds only with tens of cores.
+ *
+ * Usage: arenatourney [-t teams] [-a arenas] [-H heats] [-j workers]
+ *                     [-s seed] [-q loop us] [teams file]
+ *    -q  mean virtual time for one busy pass of loop(), default 5000us -
+ *        the stage timing follows the loop, the inputs and interrupts do
+ *        not
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "HostCore.h"
+#include "Arduino.h"
+#include "ArenaControl.h"
+#include "MatchClock.h"
+#include "QuadratureTable.h"
+#include "Quadrature.h"
+#include "Stage1.h"
+#include "Stage2.h"
+#include "Stage3.h"
+#include "StageList.h"
+
+#define VIBRATE_PIN     2
+#define FIELD_PIN       13
+
+#define HIT_PULSE_MS    2       // sensor contact closure per hit
+#define DUEL_MS         35000   // swinging from the first hit on
+#define DIGIT_PAUSE_MS  800     // rest in the center between digits
+
+/* The sketch */
+void setup(void);
+void loop(void);
+extern Stage1 stage1;
+extern Stage2 stage2;
+extern Stage3 stage3;
+
+static const StageList<Stage1, Stage2, Stage3> stages(stage1, stage2, stage3);
+
+/* Clockwise order of the encoder pin states, as in arenasim */
+static const uint8_t clockwiseOrder[4] = { 3, 1, 0, 2 };
+
+struct Team {
+   char   name[24];
+   double detect;
+   double arriveMs;
+   double swingMs;
+   double discipline;
+   double revsPerSecond;
+   double dialError;
+};
+
+/* One match, written by the child that ran it */
+struct Result {
+   uint16_t team;
+   uint16_t heat;
+   uint8_t  arena;
+   uint8_t  done;
+   uint8_t  saber;
+   uint8_t  knew;
+   uint16_t relay;
+   int16_t  stage2;
+   int16_t  stage3;
+   int16_t  total;
+};
+
+/* Shared by the workers */
+struct Shared {
+   long   next;                 // next match to run
+   Result results[1];           // one per match
+};
+
+struct Options {
+   int      teams;
+   int      arenas;
+   int      heats;
+   int      workers;
+   unsigned seed;
+   uint32_t loopUs;
+};
+
+/* Score distribution of a group of matches */
+struct Tally {
+   long   matches;
+   double sum;
+   int    best;
+   int    worst;
+
+   Tally() : matches(0), sum(0), best(-1), worst(1 << 30) {}
+   void add(int score) {
+      matches++;
+      sum += score;
+      best  = std::max(best, score);
+      worst = std::min(worst, score);
+   }
+   double mean(void) const { return matches ? sum / matches : 0.0; }
+};
+
+static std::vector<Team> teams;
+
+static double wallMs(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+static double uniform(double low, double high)
+{
+   return low + (high - low) * (rand() / (RAND_MAX + 1.0));
+}
+
+static void makeTeams(int count)
+{
+   for (int t=0; t < count; t++) {
+      Team team;
+      snprintf(team.name, sizeof(team.name), "team%02d", t + 1);
+      team.detect        = uniform(0.3, 1.0);
+      team.arriveMs      = uniform(9000, 25000);
+      team.swingMs       = uniform(300, 1500);
+      team.discipline    = uniform(0.7, 1.0);
+      team.revsPerSecond = uniform(0.3, 1.5);
+      team.dialError     = uniform(0.0, 0.3);
+      teams.push_back(team);
+   }
+}
+
+static void readTeams(const char *file)
+{
+   FILE *fp = fopen(file, "r");
+   char  text[256];
+   int   line = 0;
+
+   if (NULL == fp) {
+      perror(file);
+      exit(2);
+   }
+   while (fgets(text, sizeof(text), fp)) {
+      Team team;
+      char *hash = strchr(text, '#');
+
+      line++;
+      if (hash) {
+         *hash = '\0';
+      }
+      int fields = sscanf(text, "%23s %lf %lf %lf %lf %lf %lf", team.name, &team.detect,
+                          &team.arriveMs, &team.swingMs, &team.discipline,
+                          &team.revsPerSecond, &team.dialError);
+      if (fields <= 0) {
+         continue;
+      }
+      if (7 != fields) {
+         fprintf(stderr, "%s:%d: can't parse '%s'\n", file, line, text);
+         exit(2);
+      }
+      teams.push_back(team);
+   }
+   fclose(fp);
+}
+
+/* Schedule the evenly spaced quadrature transitions of a knob turn */
+static uint64_t driveTurn(int &phase, uint64_t at, int turns, double revsPerSecond)
+{
+   long     count = labs(turns) * QUADRATURE_CYCLES * 4;
+   int      direction = (turns < 0) ? 3 : 1;
+   uint64_t spacing = (uint64_t) (HOST_MS(1000) / (revsPerSecond * QUADRATURE_CYCLES * 4));
+
+   for (long n=1; n <= count; n++) {
+      uint8_t was = clockwiseOrder[phase];
+
+      phase = (phase + direction) & 3;
+      uint8_t pins = clockwiseOrder[phase];
+      at += spacing;
+      if ((was ^ pins) & 1) {
+         hostDrivePin(at, ENCODER_A_PIN, pins & 1);
+      }
+      if ((was ^ pins) & 2) {
+         hostDrivePin(at, ENCODER_B_PIN, (pins >> 1) & 1);
+      }
+   }
+   return at;
+}
+
+/* Child: run match 'm' and write its result */
+static int runMatch(Shared *shared, long m, const Options &options)
+{
+   Result &result = shared->results[m];
+   const Team &team = teams[result.team];
+   bool halted = false;
+
+   srand(options.seed * 1000003u + m);
+   hostConfig.lcdAttached    = false;
+   hostConfig.relayAttached  = true;
+   hostConfig.analogValue[1] = rand() % 1024;      // the floating A1 seed
+
+   try {
+      setup();
+
+      /* The robot - stage 1 tells it the combination, or it guesses */
+      uint64_t start = hostNow();
+      uint64_t nextSwing = start + HOST_MS(team.arriveMs);
+      uint64_t duelEnd = nextSwing + HOST_MS(DUEL_MS);
+      bool     waits = (uniform(0, 1) < team.discipline);
+      bool     dialed = false;
+      int      phase = 0;
+
+      result.knew = (uniform(0, 1) < team.detect);
+
+      while (hostNow() < start + HOST_MS(MATCH_RUNTIME + 10000)) {
+         uint64_t now = hostNow();
+
+         if ((now >= nextSwing) && (now < duelEnd)) {
+            if ((HIGH == hostPinLevel(FIELD_PIN)) || !waits) {
+               hostDrivePin(now, VIBRATE_PIN, LOW);
+               hostDrivePin(now + HOST_MS(HIT_PULSE_MS), VIBRATE_PIN, HIGH);
+               nextSwing = now + HOST_MS(team.swingMs * uniform(0.5, 1.5));
+               waits = (uniform(0, 1) < team.discipline);
+            }
+         }
+         if ((now >= duelEnd) && !dialed) {
+            uint64_t at = now;
+            uint16_t pattern = stage1.turnPattern;
+            int      divide = 10000;
+
+            for (int d=0; d < 5; d++, divide /= 10) {
+               int turns = result.knew ? (pattern / divide) % 10 : 1 + (rand() % 5);
+               if (uniform(0, 1) < team.dialError) {
+                  turns += ((turns > 1) && (rand() & 1)) ? -1 : 1;
+               }
+               at = driveTurn(phase, at, (d & 1) ? -turns : turns, team.revsPerSecond);
+               at += HOST_MS(DIGIT_PAUSE_MS);
+            }
+            dialed = true;
+         }
+
+         /* Loop passes vary in length on the arena too. With nothing due in
+          *    any stage, the clock skips to the next input, stage deadline
+          *    or move of the robot instead - the arena would be asleep.
+          */
+         loop();
+         uint64_t pass = (uint64_t) (HOST_US(options.loopUs) * uniform(0.5, 1.5));
+         uint32_t matchTime = Clock.now();
+         int32_t  due = (int32_t) (stages.deadline(matchTime) - matchTime);
+
+         now = hostNow();
+         if (stages.idle(matchTime) && (due > 0)) {
+            uint64_t next = std::min(hostNextInput(), now + (uint64_t) HOST_MS(due));
+            if (now < nextSwing) {
+               next = std::min(next, nextSwing);
+            }
+            if (!dialed) {
+               next = std::min(next, duelEnd);
+            }
+            if (next > now) {
+               pass = std::max(pass, next - now);
+            }
+         }
+         hostAdvance(pass);
+      }
+   } catch (HostHalt &) {
+      halted = true;
+   }
+
+   result.relay  = stage1.relayIndex;
+   result.saber  = stage2.pattern();
+   result.stage2 = stage2.score();
+   result.stage3 = stage3.score();
+   result.total  = stage1.score() + result.stage2 + result.stage3;
+   result.done   = halted;
+   fflush(stdout);
+   return halted ? 0 : 1;
+}
+
+/* Worker: run matches until the shared counter passes the last one */
+static void work(Shared *shared, long matches, const Options &options)
+{
+   for (;;) {
+      long m = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED);
+      int  status;
+
+      if (m >= matches) {
+         return;
+      }
+      pid_t pid = fork();
+      if (0 == pid) {
+         _exit(runMatch(shared, m, options));
+      }
+      if (pid > 0) {
+         waitpid(pid, &status, 0);
+      }
+   }
+}
+
+static void printTallies(const char *title, const char *key, const std::vector<Tally> &tallies,
+                         long matches)
+{
+   printf("\n%-8s %8s %6s %8s %6s %6s\n", key, "matches", "share", "mean", "best", "worst");
+   for (size_t k=0; k < tallies.size(); k++) {
+      const Tally &t = tallies[k];
+      if (t.matches) {
+         printf("%-8zu %8ld %5.1f%% %8.1f %6d %6d\n", k, t.matches,
+                100.0 * t.matches / matches, t.mean(), t.best, t.worst);
+      }
+   }
+   printf("(%s)\n", title);
+}
+
+
+int main(int argc, char **argv)
+{
+   Options options = { 24, 4, 3, (int) sysconf(_SC_NPROCESSORS_ONLN), 2017, 5000 };
+   int     opt;
+
+   while (-1 != (opt = getopt(argc, argv, "t:a:H:j:s:q:"))) {
+      switch (opt) {
+         case 't': options.teams   = atoi(optarg);    break;
+         case 'a': options.arenas  = atoi(optarg);    break;
+         case 'H': options.heats   = atoi(optarg);    break;
+         case 'j': options.workers = atoi(optarg);    break;
+         case 's': options.seed    = atoi(optarg);    break;
+         case 'q': options.loopUs  = atol(optarg);    break;
+         default:
+            fprintf(stderr, "usage: arenatourney [-t teams] [-a arenas] [-H heats] [-j workers] "
+                            "[-s seed] [-q loop us] [teams file]\n");
+            return 2;
+      }
+   }
+
+   srand(options.seed);
+   if (optind < argc) {
+      readTeams(argv[optind]);
+   } else {
+      makeTeams(options.teams);
+   }
+   if (teams.empty() || (options.arenas < 1) || (options.heats < 1) || (options.workers < 1)) {
+      fprintf(stderr, "arenatourney: nothing to run\n");
+      return 2;
+   }
+
+   /* The schedule - each heat runs every team once, in rounds across the
+    *    arenas
+    */
+   long    matches = (long) teams.size() * options.heats;
+   size_t  size = sizeof(Shared) + (matches - 1) * sizeof(Result);
+   Shared *shared = (Shared *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (MAP_FAILED == shared) {
+      perror("mmap");
+      return 2;
+   }
+   for (long m=0; m < matches; m++) {
+      shared->results[m].heat  = m / teams.size();
+      shared->results[m].team  = m % teams.size();
+      shared->results[m].arena = (m % teams.size()) % options.arenas;
+   }
+
+   double started = wallMs();
+
+   fflush(stdout);
+   for (int w=0; w < options.workers; w++) {
+      if (0 == fork()) {
+         work(shared, matches, options);
+         _exit(0);
+      }
+   }
+   while (wait(NULL) > 0) {
+   }
+   double elapsed = wallMs() - started;
+
+   /* Standings and distributions */
+   std::vector<Tally> byTeam(teams.size()), byRelay, bySaber(10), byArena(options.arenas);
+   long failed = 0, knew = 0;
+
+   for (long m=0; m < matches; m++) {
+      const Result &r = shared->results[m];
+      if (!r.done) {
+         failed++;
+         continue;
+      }
+      if (r.relay >= byRelay.size()) {
+         byRelay.resize(r.relay + 1);
+      }
+      byTeam[r.team].add(r.total);
+      byRelay[r.relay].add(r.stage3);
+      bySaber[r.saber % 10].add(r.stage2);
+      byArena[r.arena].add(r.total);
+      knew += r.knew;
+   }
+
+   printf("%ld matches (%zu teams x %d heats, %d arenas), %d workers, %.2fs (%.2f ms/match), "
+          "%ld failed, %.0f%% knew the combination\n",
+          matches, teams.size(), options.heats, options.arenas, options.workers,
+          elapsed / 1e3, elapsed / matches, failed, 100.0 * knew / matches);
+
+   std::vector<size_t> order(teams.size());
+   for (size_t t=0; t < order.size(); t++) {
+      order[t] = t;
+   }
+   std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return (byTeam[a].best != byTeam[b].best) ? (byTeam[a].best > byTeam[b].best)
+                                                : (byTeam[a].mean() > byTeam[b].mean());
+   });
+   printf("\n%4s %-24s %6s %8s %6s %6s\n", "rank", "team", "heats", "mean", "best", "worst");
+   for (size_t n=0; n < order.size(); n++) {
+      const Tally &t = byTeam[order[n]];
+      printf("%4zu %-24s %6ld %8.1f %6d %6d\n", n + 1, teams[order[n]].name,
+             t.matches, t.mean(), t.best, t.worst);
+   }
+
+   printTallies("total score by arena", "arena", byArena, matches - failed);
+   printTallies("stage 3 score by relay pattern", "relay", byRelay, matches - failed);
+   printTallies("stage 2 score by fighting pattern", "saber", bySaber, matches - failed);
+
+   munmap(shared, size);
+   return failed ? 1 : 0;
+}
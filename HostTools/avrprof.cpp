@@ -0,0 +1,350 @@
+/*
+ * Cycle counts of the arena interrupt handlers and stage steps on the
+ *    real target, from the UNO build of the sketch run under simavr
+ *
+ * 'make profile' builds the sketch for the UNO with arduino-cli, with
+ *    PROFILE_CALLS so that LTO leaves the watched functions out of line
+ *    (see ArenaControl.h), and lists its symbols with avr-nm, then runs
+ *    it here on a simulated ATmega328P at 16MHz through one scripted
+ *    match. The controller box and relay board are not attached, so the
+ *    match starts at reset. The script dials 3-1-5-2-4 on the knob and
+ *    hits the saber in bursts.
+ *
+ * Each instruction is stepped, and a call to a watched function (an
+ *    interrupt vector or a step() method) is timed from its first
+ *    instruction to its return, in CPU cycles. Interrupts taken inside a
+ *    step() are not counted in its time, so the step() numbers are the
+ *    code's own. The cycles to respond to an interrupt and jump through
+ *    the vector table (7) are not counted in the handlers. The
+ *    simulation is deterministic, so the numbers only change when the
+ *    code does and the output can be diffed commit to commit - 'make
+ *    profile' leaves it in profile.txt. A watched function that is not
+ *    in the listing is reported and left out.
+ *
+ * The run ends when the sketch first calls ResultLog::poll(), which it
+ *    only does once the match is over and its results are saved, or
+ *    after the time limit - by default the whole match (MATCH_RUNTIME)
+ *    and LIMIT_MARGIN seconds more.
+ *
+ * Needs arduino-cli (arduino:avr core, Adafruit NeoPixel library),
+ *    avr-nm, and libsimavr with its headers.
+ *
+ * Usage: avrprof [-s seconds] sketch.elf symbols.txt
+ *    symbols.txt is 'avr-nm --defined-only -C sketch.elf'
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+
+#include "QuadratureTable.h"
+
+#define CPU_HZ           16000000
+#define DATA_SPL         0x5D        // SPL/SPH in the data space
+#define DATA_SPH         0x5E
+
+#define VIBRATE_PIN      2           // PD2, INT0
+#define ENCODER_A_PIN    3           // PD3
+#define ENCODER_B_PIN    4           // PD4
+
+#define CYCLES_MS(ms)    ((avr_cycle_count_t) ((ms) * (CPU_HZ / 1000.0)))
+
+#define LIMIT_MARGIN     30          // seconds past MATCH_RUNTIME to give up
+#define END_SYMBOL       "ResultLog::poll("
+
+/* What to time - the symbol is matched against the start of the avr-nm
+ *    name, so static functions renamed by LTO are still found
+ */
+struct Watch {
+   const char *symbol;
+   const char *label;
+   bool        isr;
+};
+
+static const Watch watches[] = {
+   { "__vector_1",                   "INT0 vibration sensor",       true  },
+   { "__vector_3",                   "PCINT0",                      true  },
+   { "__vector_4",                   "PCINT1",                      true  },
+   { "__vector_5",                   "PCINT2 encoder",              true  },
+   { "__vector_7",                   "TIMER2_COMPA encoder sample", true  },
+   { "__vector_16",                  "TIMER0_OVF millis",           true  },
+   { "__vector_18",                  "USART_RX",                    true  },
+   { "__vector_19",                  "USART_UDRE serial TX",        true  },
+   { "__vector_24",                  "TWI",                         true  },
+   { "vibrate(",                     "vibrate (in INT0)",           false },
+   { "Controller::step(",            "Controller::step",            false },
+   { "Stage1::step(",                "Stage1::step",                false },
+   { "Stage2::step(",                "Stage2::step",                false },
+   { "Stage3::step(",                "Stage3::step",                false },
+   { "loop(",                        "loop",                        false },
+};
+#define WATCHES  (sizeof(watches) / sizeof(watches[0]))
+
+struct Stats {
+   uint64_t calls;
+   uint64_t min;
+   uint64_t max;
+   uint64_t total;
+};
+
+/* A watched call in progress */
+struct Frame {
+   int               watch;
+   avr_cycle_count_t start;
+   uint16_t          sp;            // SP at entry, the return address is above it
+   avr_cycle_count_t interrupted;   // cycles in interrupts taken meanwhile
+};
+
+/* A scripted input change */
+struct Input {
+   avr_cycle_count_t at;
+   uint8_t           pin;
+   uint8_t           level;
+};
+
+static Stats              stats[WATCHES];
+static std::vector<int>   watchAt;          // watch index by word address, -1 if none
+static long               endAt = -1;       // word address of END_SYMBOL
+static std::vector<Input> inputs;
+static size_t             nextInput;
+static avr_irq_t         *portD[8];
+
+
+/* Read the avr-nm listing and mark the entry of each watched function */
+static void loadSymbols(const char *file, uint32_t flashBytes)
+{
+   FILE *fp = fopen(file, "r");
+   char  line[512];
+   int   found[WATCHES] = { 0 };
+
+   if (NULL == fp) {
+      perror(file);
+      exit(2);
+   }
+   watchAt.assign(flashBytes / 2, -1);
+
+   while (fgets(line, sizeof(line), fp)) {
+      unsigned long address;
+      char          type;
+      int           used = 0;
+
+      if ((2 != sscanf(line, "%lx %c %n", &address, &type, &used)) || !strchr("TtWw", type)) {
+         continue;
+      }
+      const char *name = line + used;
+      for (size_t w=0; w < WATCHES; w++) {
+         size_t length = strlen(watches[w].symbol);
+         bool   exact  = ('_' == watches[w].symbol[0]);
+
+         if ((0 == strncmp(name, watches[w].symbol, length)) &&
+             (!exact || strchr("\r\n", name[length])) && (address / 2 < watchAt.size())) {
+            watchAt[address / 2] = w;
+            found[w]++;
+         }
+      }
+      if (0 == strncmp(name, END_SYMBOL, strlen(END_SYMBOL))) {
+         endAt = address / 2;
+      }
+   }
+   fclose(fp);
+
+   if (endAt < 0) {
+      fprintf(stderr, "avrprof: %s not in %s, running to the time limit\n", END_SYMBOL, file);
+   }
+
+   for (size_t w=0; w < WATCHES; w++) {
+      if (!found[w]) {
+         fprintf(stderr, "avrprof: %s not in %s, not timed\n", watches[w].symbol, file);
+      }
+   }
+}
+
+static void addInput(double ms, uint8_t pin, uint8_t level)
+{
+   Input input = { CYCLES_MS(ms), pin, level };
+   inputs.push_back(input);
+}
+
+/* The match script - knob turns (clockwise pin order as in arenasim) and
+ *    saber hits with a little contact bounce
+ */
+static void makeScript(void)
+{
+   static const uint8_t clockwiseOrder[4] = { 3, 1, 0, 2 };
+   static const int     combination[5] = { 3, 1, 5, 2, 4 };
+   int    phase = 0;
+   double ms = 2000;
+
+   for (int d=0; d < 5; d++) {
+      int  direction = (d & 1) ? 3 : 1;
+      long count = (long) combination[d] * QUADRATURE_CYCLES * 4;
+
+      for (long n=0; n < count; n++) {
+         uint8_t was = clockwiseOrder[phase];
+         phase = (phase + direction) & 3;
+         uint8_t pins = clockwiseOrder[phase];
+
+         ms += 1000.0 / (QUADRATURE_CYCLES * 4);   // one revolution a second
+         if ((was ^ pins) & 1) {
+            addInput(ms, ENCODER_A_PIN, pins & 1);
+         }
+         if ((was ^ pins) & 2) {
+            addInput(ms, ENCODER_B_PIN, (pins >> 1) & 1);
+         }
+      }
+      ms += 1500;
+   }
+
+   for (int burst=0; burst < 10; burst++) {
+      for (int h=0; h < 3; h++) {
+         double at = 5000 + burst * 3000 + h * 150;
+         addInput(at,        VIBRATE_PIN, 0);
+         addInput(at + 0.05, VIBRATE_PIN, 1);
+         addInput(at + 0.10, VIBRATE_PIN, 0);
+         addInput(at + 2.00, VIBRATE_PIN, 1);
+      }
+   }
+
+   std::stable_sort(inputs.begin(), inputs.end(),
+                    [](const Input &a, const Input &b) { return a.at < b.at; });
+}
+
+/* Cycle timer - drive the inputs due now, then wait for the next one */
+static avr_cycle_count_t driveInputs(avr_t *avr, avr_cycle_count_t when, void *param)
+{
+   while ((nextInput < inputs.size()) && (inputs[nextInput].at <= avr->cycle)) {
+      avr_raise_irq(portD[inputs[nextInput].pin], inputs[nextInput].level);
+      nextInput++;
+   }
+   return (nextInput < inputs.size()) ? inputs[nextInput].at : 0;
+}
+
+static uint16_t stackPointer(avr_t *avr)
+{
+   return avr->data[DATA_SPL] | (avr->data[DATA_SPH] << 8);
+}
+
+static void finish(const Frame &frame, avr_cycle_count_t now, std::vector<Frame> &stack)
+{
+   Stats   &s = stats[frame.watch];
+   uint64_t cycles = now - frame.start - (watches[frame.watch].isr ? 0 : frame.interrupted);
+
+   s.min = (0 == s.calls) ? cycles : std::min(s.min, cycles);
+   s.max = std::max(s.max, cycles);
+   s.total += cycles;
+   s.calls++;
+
+   /* A handler's time is taken out of everything it interrupted */
+   if (watches[frame.watch].isr) {
+      for (size_t f=0; f < stack.size(); f++) {
+         stack[f].interrupted += now - frame.start;
+      }
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   double limit = MATCH_RUNTIME / 1000.0 + LIMIT_MARGIN;
+   int    opt;
+
+   while (-1 != (opt = getopt(argc, argv, "s:"))) {
+      switch (opt) {
+         case 's': limit = atof(optarg);    break;
+         default:
+            fprintf(stderr, "usage: avrprof [-s seconds] sketch.elf symbols.txt\n");
+            return 2;
+      }
+   }
+   if (argc - optind != 2) {
+      fprintf(stderr, "usage: avrprof [-s seconds] sketch.elf symbols.txt\n");
+      return 2;
+   }
+
+   elf_firmware_t firmware;
+   memset(&firmware, 0, sizeof(firmware));
+   if (0 != elf_read_firmware(argv[optind], &firmware)) {
+      fprintf(stderr, "avrprof: can't read %s\n", argv[optind]);
+      return 2;
+   }
+
+   avr_t *avr = avr_make_mcu_by_name("atmega328p");
+   if (NULL == avr) {
+      fprintf(stderr, "avrprof: simavr has no atmega328p\n");
+      return 2;
+   }
+   avr_init(avr);
+   avr_load_firmware(avr, &firmware);
+   avr->frequency = CPU_HZ;
+   loadSymbols(argv[optind + 1], avr->flashend + 1);
+
+   /* Serial output stays in the simulator, stdout is the report */
+   uint32_t flags = 0;
+   avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+   flags &= ~AVR_UART_FLAG_STDIO;
+   avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+   for (int pin=0; pin < 8; pin++) {
+      portD[pin] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), pin);
+   }
+   makeScript();
+   avr_raise_irq(portD[VIBRATE_PIN], 1);
+   avr_raise_irq(portD[ENCODER_A_PIN], 1);
+   avr_raise_irq(portD[ENCODER_B_PIN], 1);
+   avr_cycle_timer_register(avr, inputs[0].at, driveInputs, NULL);
+
+   std::vector<Frame> stack;
+   avr_cycle_count_t  end = CYCLES_MS(limit * 1000);
+   bool               halted = false;
+   int                state = cpu_Running;
+
+   while ((avr->cycle < end) && (cpu_Done != state) && (cpu_Crashed != state)) {
+      avr_flashaddr_t pc = avr->pc;
+
+      /* The end of the match - the results are saved, and the sketch
+       *    answers result log dumps from here on
+       */
+      if ((long) (pc / 2) == endAt) {
+         halted = true;
+         break;
+      }
+
+      if ((pc / 2 < watchAt.size()) && (watchAt[pc / 2] >= 0)) {
+         Frame frame = { watchAt[pc / 2], avr->cycle, stackPointer(avr), 0 };
+         stack.push_back(frame);
+      }
+
+      state = avr_run(avr);
+
+      /* Returned from everything whose return address is now popped */
+      while (!stack.empty() && (stackPointer(avr) > stack.back().sp)) {
+         Frame frame = stack.back();
+         stack.pop_back();
+         finish(frame, avr->cycle, stack);
+      }
+   }
+
+   printf("# avrprof %s: %.1f s simulated, %s\n", argv[optind], avr->cycle / (double) CPU_HZ,
+          halted ? "match ended" : "time limit");
+   printf("# cycles at 16MHz, step() times without the interrupts taken inside\n");
+   printf("%-30s %8s %8s %8s %8s\n", "function", "calls", "min", "mean", "max");
+   for (size_t w=0; w < WATCHES; w++) {
+      const Stats &s = stats[w];
+      if (s.calls) {
+         printf("%-30s %8llu %8llu %8llu %8llu\n", watches[w].label,
+                (unsigned long long) s.calls, (unsigned long long) s.min,
+                (unsigned long long) (s.total / s.calls), (unsigned long long) s.max);
+      }
+   }
+   return halted ? 0 : 1;
+}
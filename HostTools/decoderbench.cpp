@@ -0,0 +1,151 @@
+/*
+ * Host benchmark of the stage 3 digit decoder
+ *
+ * Builds a large synthetic trace of encoder positions - many matches,
+ *    each dialing a random 5 digit combination with jitter in the knob
+ *    position and a random number of counts between samples (as the
+ *    arena loop would see it) - then times DigitDecoder over the whole
+ *    trace and checks every match decoded to the combination dialed.
+ *
+ * Usage: decoderbench [matches] [max counts between samples] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "DigitDecoder.h"
+
+struct Match {
+   size_t  first;          // index of first sample in the trace
+   size_t  samples;        // number of samples in the match
+   uint8_t digits[5];      // combination dialed
+};
+
+static std::vector<long>  trace;
+static std::vector<Match> matches;
+
+
+/* Add samples walking the knob from 'from' to 'to' in random sized steps,
+ *    with small back and forth jitter while well away from a center
+ */
+static long travel(long from, long to, int maxStep)
+{
+   long position = from;
+
+   while (position != to) {
+      long remaining = labs(to - position);
+      long step = 1 + (rand() % maxStep);
+      int  direction = (to > position) ? 1 : -1;
+      int  relative = (int) (labs(position) % ONE_REVOLUTION);
+
+      if (step > remaining) {
+         step = remaining;
+      }
+
+      /* jitter backwards a little, only when clear of any center window */
+      if ((relative > (PLUS_MINUS + 8)) && (relative < (ONE_REVOLUTION - PLUS_MINUS - 8)) &&
+          (0 == (rand() % 8))) {
+         trace.push_back(position - direction * (1 + rand() % 3));
+      }
+
+      position += direction * step;
+      trace.push_back(position);
+   }
+
+   return position;
+}
+
+
+/* Dial a random 5 digit combination (1..5 turns each, alternating
+ *    clockwise and counterclockwise) and rest in the final center
+ */
+static void generateMatch(int maxStep)
+{
+   Match match;
+   long  position = 0;
+   int   direction = 1;
+   int   loop;
+
+   match.first = trace.size();
+   for (loop=0; loop < 5; loop++) {
+      match.digits[loop] = 1 + (rand() % 5);
+      position = travel(position, position + direction * match.digits[loop] * ONE_REVOLUTION, maxStep);
+
+      /* settle somewhere inside the center window */
+      trace.push_back(position + (rand() % (2*PLUS_MINUS - 1)) - (PLUS_MINUS - 1));
+      trace.push_back(position);
+      direction = -direction;
+   }
+   match.samples = trace.size() - match.first;
+   matches.push_back(match);
+}
+
+
+static double seconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char **argv) 
+{
+   int      numMatches = (argc > 1) ? atoi(argv[1]) : 100000;
+   int      maxStep    = (argc > 2) ? atoi(argv[2]) : 16;
+   unsigned seed       = (argc > 3) ? atoi(argv[3]) : 2017;
+   size_t   correct = 0;
+   size_t   digitsDecoded = 0;
+   long     counts = 0;
+   DigitDecoder decoder;
+   double   start, elapsed;
+   int      loop;
+
+   srand(seed);
+   for (loop=0; loop < numMatches; loop++) {
+      generateMatch(maxStep);
+   }
+
+   start = seconds();
+   for (size_t m=0; m < matches.size(); m++) {
+      const Match &match = matches[m];
+      uint8_t found[5];
+
+      decoder.reset();
+      for (size_t s=match.first; s < match.first + match.samples; s++) {
+         digitsDecoded += decoder.feed(trace[s]);
+      }
+      digitsDecoded += decoder.finish();
+
+      if ((5 == decoder.lastDigits(found, 5)) && (0 == memcmp(found, match.digits, 5))) {
+         correct++;
+      }
+   }
+   elapsed = seconds() - start;
+
+   /* total knob travel walked by the decoder - each match starts from
+    *    the reset position 0, not from where the last match left off
+    */
+   for (size_t m=0; m < matches.size(); m++) {
+      long previous = 0;
+
+      for (size_t s=matches[m].first; s < matches[m].first + matches[m].samples; s++) {
+         counts += labs(trace[s] - previous);
+         previous = trace[s];
+      }
+   }
+
+   printf("matches        : %zu\n", matches.size());
+   printf("samples        : %zu\n", trace.size());
+   printf("counts walked  : %ld\n", counts);
+   printf("digits decoded : %zu\n", digitsDecoded);
+   printf("decoded exactly: %zu / %zu\n", correct, matches.size());
+   printf("elapsed        : %.3f s\n", elapsed);
+   printf("throughput     : %.1f Msamples/s, %.1f Mcounts/s, %.1f ns/sample\n",
+          trace.size() / elapsed / 1e6, counts / elapsed / 1e6, elapsed * 1e9 / trace.size());
+
+   return (correct == matches.size()) ? 0 : 1;
+}
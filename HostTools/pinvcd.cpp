@@ -0,0 +1,290 @@
+/*
+ * Turn arenasim pin traces into VCD files
+ *
+ * Reads the pin level changes arenasim -p writes - "<ns> <pin> <level>"
+ *    lines, with a "# match" line starting each match and a "# reset"
+ *    line each boot after a reset - and writes each match as one VCD
+ *    file, to look at in a waveform viewer (GTKWave, PulseView). Every
+ *    pin is a 1 bit signal named after what the arena wires to it (see
+ *    ArenaControl.h).
+ *
+ * The timing trace of a PIN_TRACE build (see PinTrace.h) is decoded as
+ *    well: while D11 or D12 is high, isr_source or step_source holds
+ *    the number of highs so far in its pulse train - so once the train
+ *    is over and the window is open, the source of the window - and 0
+ *    while it is low. A high that starts more than 3 cycles after the
+ *    last one ended starts a new train. A summary line per match gives
+ *    the windows of each source: how many, and their longest and total
+ *    time.
+ *
+ * Usage: pinvcd [-o prefix] trace...
+ *    -o  output files are <prefix>-<n>.vcd, n counting matches from 1
+ *        across the traces (default "pins")
+ *    -   as a trace reads stdin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include "PinTrace.h"
+
+#define PINS            20
+#define TRAIN_GAP_NS    187         // 3 cycles at 16MHz
+#define SOURCES         8           // codes 1-7 on each trace pin
+
+/* What the arena wires to each pin (see ArenaControl.h) */
+static const char *pinNames[PINS] = {
+   "D0_rx", "D1_tx", "D2_vibration", "D3_encoder_b", "D4_encoder_a", "D5_encoder_button",
+   "D6_neopixel", "D7_led_enable", "D8_led_red", "D9_led_green", "D10_led_blue",
+   "D11_trace_isr", "D12_trace_step", "D13_coil",
+   "A0_start", "A1_seed", "A2", "A3_stop", "A4_sda", "A5_scl"
+};
+
+static const char *isrNames[SOURCES] = {
+   "", "encoder", "vibration", "timebase", "watchdog", "buttons", "?", "?"
+};
+
+static const char *stepNames[SOURCES] = {
+   "", "checkpoint", "controller", "stage1", "stage2", "stage3", "console", "telemetry"
+};
+
+/* Windows of one source */
+struct WindowStats {
+   long     count;
+   uint64_t total;              // ns
+   uint64_t longest;
+};
+
+/* Pulse train decoder of one trace pin */
+struct Decoder {
+   const char  *signal;         // VCD name of the decoded source
+   char         id;             // and its VCD identifier
+   const char **names;
+   bool         known;          // a level has been seen since the boot
+   uint8_t      level;
+   uint8_t      count;          // highs so far in the train
+   uint64_t     rose;           // ns, of the last high
+   uint64_t     fell;
+   bool         pending;        // the last high may be a window
+   WindowStats  stats[SOURCES];
+};
+
+/* The match being written */
+struct Converter {
+   std::string prefix;
+   int         match;           // matches so far
+   FILE       *out;
+   std::string path;
+   std::string title;           // script and seed, from the "# match" line
+   uint64_t    time;            // of the last change written
+   bool        timed;           // a time has been written
+   uint8_t     level[PINS];     // as written, 2 before the first
+   Decoder     decoder[2];      // D11, D12
+};
+
+static void change(Converter &conv, uint64_t at, char id, const char *value)
+{
+   if (!conv.timed || (at != conv.time)) {
+      fprintf(conv.out, "#%llu\n", (unsigned long long) at);
+      conv.time = at;
+      conv.timed = true;
+   }
+   fprintf(conv.out, "%s%c\n", value, id);
+}
+
+/* 3 bit decoded source as a VCD vector value */
+static void source(Converter &conv, uint64_t at, const Decoder &dec, uint8_t code)
+{
+   char value[8];
+
+   snprintf(value, sizeof(value), "b%u%u%u ", (code >> 2) & 1, (code >> 1) & 1, code & 1);
+   change(conv, at, dec.id, value);
+}
+
+/* The last high of a train is its window */
+static void closeTrain(Decoder &dec)
+{
+   if (dec.pending) {
+      WindowStats &stats = dec.stats[dec.count % SOURCES];
+      uint64_t     width = dec.fell - dec.rose;
+
+      stats.count++;
+      stats.total += width;
+      if (width > stats.longest) {
+         stats.longest = width;
+      }
+      dec.pending = false;
+   }
+}
+
+static void decode(Converter &conv, Decoder &dec, uint64_t at, uint8_t level)
+{
+   if (!dec.known) {
+      /* The level at the start of a boot, not an edge */
+      dec.known = true;
+      dec.level = level;
+      dec.count = 0;
+      dec.pending = false;
+      source(conv, at, dec, 0);
+      return;
+   }
+   if (level == dec.level) {
+      return;
+   }
+   dec.level = level;
+
+   if (level) {
+      if (!dec.count || (at - dec.fell > TRAIN_GAP_NS)) {
+         closeTrain(dec);
+         dec.count = 0;
+      }
+      dec.pending = false;
+      dec.count++;
+      dec.rose = at;
+      source(conv, at, dec, dec.count % SOURCES);
+   } else if (dec.count) {
+      dec.fell = at;
+      dec.pending = true;
+      source(conv, at, dec, 0);
+   }
+}
+
+static void printStats(const Decoder &dec, const char *pin)
+{
+   printf("   %s:", pin);
+   for (int code=1; code < SOURCES; code++) {
+      const WindowStats &stats = dec.stats[code];
+      if (stats.count) {
+         printf(" %s=%ld (max %.1fus, %.1fms)", dec.names[code], stats.count,
+                stats.longest / 1e3, stats.total / 1e6);
+      }
+   }
+   printf("\n");
+}
+
+static void endMatch(Converter &conv)
+{
+   if (NULL == conv.out) {
+      return;
+   }
+   closeTrain(conv.decoder[0]);
+   closeTrain(conv.decoder[1]);
+   fclose(conv.out);
+   conv.out = NULL;
+
+   printf("%s: %s\n", conv.path.c_str(), conv.title.c_str());
+   printStats(conv.decoder[0], "D11");
+   printStats(conv.decoder[1], "D12");
+}
+
+static bool startMatch(Converter &conv, const char *title)
+{
+   endMatch(conv);
+
+   conv.path = conv.prefix + "-" + std::to_string(++conv.match) + ".vcd";
+   conv.out = fopen(conv.path.c_str(), "w");
+   if (NULL == conv.out) {
+      perror(conv.path.c_str());
+      return false;
+   }
+   conv.title = title;
+   conv.timed = false;
+
+   Decoder isr  = { "isr_source",  (char) ('!' + PINS),     isrNames };
+   Decoder step = { "step_source", (char) ('!' + PINS + 1), stepNames };
+   conv.decoder[0] = isr;
+   conv.decoder[1] = step;
+
+   fprintf(conv.out, "$comment %s $end\n", title);
+   fprintf(conv.out, "$timescale 1ns $end\n");
+   fprintf(conv.out, "$scope module arena $end\n");
+   for (int pin=0; pin < PINS; pin++) {
+      fprintf(conv.out, "$var wire 1 %c %s $end\n", '!' + pin, pinNames[pin]);
+      conv.level[pin] = 2;
+   }
+   for (int n=0; n < 2; n++) {
+      fprintf(conv.out, "$var wire 3 %c %s $end\n", conv.decoder[n].id, conv.decoder[n].signal);
+   }
+   fprintf(conv.out, "$upscope $end\n$enddefinitions $end\n");
+   return true;
+}
+
+static bool readTrace(FILE *in, Converter &conv)
+{
+   char line[256];
+
+   while (fgets(line, sizeof(line), in)) {
+      unsigned long long at;
+      unsigned           pin, level;
+
+      line[strcspn(line, "\r\n")] = 0;
+      if (0 == strncmp(line, "# match ", 8)) {
+         if (!startMatch(conv, line + 8)) {
+            return false;
+         }
+      } else if (0 == strncmp(line, "# reset ", 8)) {
+         /* A new boot - its first level of each trace pin is not an edge */
+         conv.decoder[0].known = false;
+         conv.decoder[1].known = false;
+      } else if ((3 == sscanf(line, "%llu %u %u", &at, &pin, &level)) && (pin < PINS)) {
+         if ((NULL == conv.out) && !startMatch(conv, "?")) {
+            return false;
+         }
+         level = level ? 1 : 0;
+         if (level != conv.level[pin]) {
+            conv.level[pin] = level;
+            change(conv, at, '!' + pin, level ? "1" : "0");
+         }
+         if (PIN_TRACE_ISR_PIN == pin) {
+            decode(conv, conv.decoder[0], at, level);
+         } else if (PIN_TRACE_STEP_PIN == pin) {
+            decode(conv, conv.decoder[1], at, level);
+         }
+      }
+   }
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   Converter conv;
+   int       opt;
+
+   conv.prefix = "pins";
+   conv.match = 0;
+   conv.out = NULL;
+
+   while (-1 != (opt = getopt(argc, argv, "o:"))) {
+      switch (opt) {
+         case 'o': conv.prefix = optarg;  break;
+         default:
+            fprintf(stderr, "usage: pinvcd [-o prefix] trace...\n");
+            return 2;
+      }
+   }
+   if (optind >= argc) {
+      fprintf(stderr, "usage: pinvcd [-o prefix] trace...\n");
+      return 2;
+   }
+
+   for (int a=optind; a < argc; a++) {
+      FILE *in = strcmp(argv[a], "-") ? fopen(argv[a], "r") : stdin;
+
+      if (NULL == in) {
+         perror(argv[a]);
+         return 2;
+      }
+      bool ok = readTrace(in, conv);
+      if (stdin != in) {
+         fclose(in);
+      }
+      if (!ok) {
+         return 2;
+      }
+   }
+   endMatch(conv);
+   return 0;
+}
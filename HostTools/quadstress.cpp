@@ -0,0 +1,159 @@
+/*
+ * Stress the encoder interrupt against real foreground load
+ *
+ * Runs the real Quadrature.cpp decoder (in the mode and resolution it
+ *    is built with) on the host core, with synthetic quadrature bursts
+ *    from QuadModel.h driven onto the encoder pins at sweeping rates,
+ *    while the foreground does what the arena loop does - NeoPixel
+ *    writes that keep interrupts off for 240us, and LCD updates whose
+ *    I2C traffic keeps them off for each TWI interrupt. Each interrupt
+ *    handler takes ISR_CYCLES of CPU time, so edges that land inside a
+ *    handler or a blackout wait for it like they do on the UNO.
+ *
+ * Reports, against the transition rate, the encoder interrupts run,
+ *    the ones held off by the foreground, the CPU time in the encoder
+ *    interrupt and the counts missed (decoded vs true final position).
+ *
+ * Usage: quadstress [transitions per run] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "HostCore.h"
+#include "Arduino.h"
+#include "Adafruit_NeoPixel.h"
+#include "Sainsmart_I2CLCD.h"
+#include "Quadrature.h"
+#include "QuadModel.h"
+
+#define LOAD_PIXELS     (1 << 0)
+#define LOAD_LCD        (1 << 1)
+
+#define LOOP_US         200     // foreground work per pass apart from the load
+
+struct Load {
+   const char *name;
+   int         flags;
+};
+
+struct Burst {
+   const char *name;
+   double jitter;              // fraction of the transition period
+   int    bounces;             // bounce toggle pairs per real transition
+   double window;              // microseconds the bounce lasts
+};
+
+static Adafruit_NeoPixel strip(8, 6);
+static Sainsmart_I2CLCD  lcd(0x27, 20, 4);
+
+/* One pass of the foreground - the same LCD updates as Controller::step
+ *    and a saber update
+ */
+static void foreground(int flags, uint32_t pass)
+{
+   if (flags & LOAD_LCD) {
+      lcd.setCursor(14, 0);
+      lcd.print(pass / 100);
+      lcd.print(".");
+      lcd.print(pass % 10);
+      lcd.setCursor(15, 2);
+      lcd.print((pass % 3) ? "STOP" : "    ");
+      lcd.setCursor(13, 3);
+      lcd.print("      ");
+      lcd.setCursor(14 + (pass % 3), 3);
+      lcd.print("vvv");
+   }
+   if (flags & LOAD_PIXELS) {
+      for (uint16_t i=0; i < strip.numPixels(); i++) {
+         strip.setPixelColor(i, (pass & 1) ? 0xFF0000 : 0x0000FF);
+      }
+      strip.show();
+   }
+   Quadrature.read();
+   hostAdvance(HOST_US(LOOP_US));
+}
+
+/* Child: decode one burst under one load and print the result row */
+static int run(const Load &load, const Burst &burst, double rate, long transitions, unsigned seed)
+{
+   srand(seed);
+   Waveform wave = makeWaveform(transitions, rate, burst.jitter, burst.bounces, burst.window, 0.0);
+
+   hostConfig.isrCycles = ISR_CYCLES;
+   if (load.flags & LOAD_LCD) {
+      lcd.init();
+      lcd.backlight();
+   }
+   strip.begin();
+   Quadrature.start();
+
+   uint64_t start = hostNow() + HOST_MS(1);
+   for (size_t e=0; e < wave.edges.size(); e++) {
+      hostDrivePins(start + (uint64_t) (wave.edges[e].t * 1000.0), ENCODER_A_PIN, 3, wave.edges[e].pins);
+   }
+
+   HostStats before = hostStats;
+   uint64_t  end = start + (uint64_t) (wave.duration * 1000.0) + HOST_MS(1);
+   uint32_t  pass = 0;
+
+   while (hostNow() < end) {
+      foreground(load.flags, pass++);
+   }
+
+   long expected = wave.truePosition * QUADRATURE_RESOLUTION / 4;
+   long decoded  = Quadrature.read();
+   double busy   = (hostStats.isrTime - before.isrTime) / 1e3;
+
+   printf("%-7s %-16s %8.0f | %7llu %8llu %7.2f%% | %7ld\n",
+          load.name, burst.name, rate,
+          (unsigned long long) (hostStats.isrCalls - before.isrCalls),
+          (unsigned long long) (hostStats.deferredIsrs - before.deferredIsrs),
+          100.0 * busy / (wave.duration + 1000.0),
+          labs(expected - decoded));
+   fflush(stdout);
+   return 0;
+}
+
+int main(int argc, char **argv)
+{
+   long     transitions = (argc > 1) ? atol(argv[1]) & ~3L : 4000;
+   unsigned seed        = (argc > 2) ? atoi(argv[2]) : 2017;
+   double   rates[]     = { 1000, 2000, 5000, 8000, 10000, 15000, 20000, 40000 };
+   Load     loads[]     = {
+      { "none",   0 },
+      { "pixels", LOAD_PIXELS },
+      { "lcd",    LOAD_LCD },
+      { "arena",  LOAD_PIXELS | LOAD_LCD },
+   };
+   Burst    bursts[]    = {
+      { "clean",          0.1, 0,  0.0 },
+      { "jitter 40%",     0.4, 0,  0.0 },
+      { "bounce 4x20us",  0.1, 4, 20.0 },
+   };
+
+   printf("# %s mode, x%d, %d cycles per interrupt, %ld transitions per run\n",
+          (QUADRATURE_MODE == QUADRATURE_SAMPLED) ? "sampled" : "edge",
+          QUADRATURE_RESOLUTION, ISR_CYCLES, transitions);
+   printf("%-7s %-16s %8s | %7s %8s %8s | %7s\n",
+          "load", "burst", "trans/s", "isr", "deferred", "cpu", "missed");
+
+   for (size_t l=0; l < sizeof(loads)/sizeof(loads[0]); l++) {
+      for (size_t b=0; b < sizeof(bursts)/sizeof(bursts[0]); b++) {
+         for (size_t r=0; r < sizeof(rates)/sizeof(rates[0]); r++) {
+            int status;
+
+            /* Fresh decoder and clock for every run */
+            fflush(stdout);
+            pid_t pid = fork();
+            if (0 == pid) {
+               _exit(run(loads[l], bursts[b], rates[r], transitions, seed));
+            }
+            waitpid(pid, &status, 0);
+         }
+      }
+   }
+   return 0;
+}